@@ -0,0 +1,489 @@
+#include "BatchFileReader.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+//Thread pool only
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define STLVIEWER_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <cerrno>
+#include <cstring>
+#include <initializer_list>
+#endif
+
+namespace {
+#ifdef STLVIEWER_HAS_IO_URING
+    //Minimal io_uring wrapper on the raw system calls (liburing isn't required)
+    class IoUring {
+    public:
+        ~IoUring() {
+            if (sqes)
+                munmap(sqes, sqeBytes);
+            if (cqRing && cqRing != sqRing)
+                munmap(cqRing, cqBytes);
+            if (sqRing)
+                munmap(sqRing, sqBytes);
+            if (ringFd >= 0)
+                ::close(ringFd);
+        }
+
+        bool init(unsigned entries) {
+            io_uring_params params{};
+            ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if (ringFd < 0)
+                return false;
+
+            sqBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMap)
+                sqBytes = cqBytes = std::max(sqBytes, cqBytes);
+
+            sqRing = mapRing(sqBytes, IORING_OFF_SQ_RING);
+            if (!sqRing)
+                return false;
+            cqRing = singleMap ? sqRing : mapRing(cqBytes, IORING_OFF_CQ_RING);
+            if (!cqRing)
+                return false;
+            sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe*>(mapRing(sqeBytes, IORING_OFF_SQES));
+            if (!sqes)
+                return false;
+
+            char* sq = static_cast<char*>(sqRing);
+            sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            char* cq = static_cast<char*>(cqRing);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            capacity = params.sq_entries;
+            return supportsOps({ IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE });
+        }
+
+        unsigned entries() const { return capacity; }
+
+        //Submission slots not taken by prepared requests or by ones the kernel hasn't picked up yet
+        unsigned freeEntries() const {
+            return capacity - (__atomic_load_n(sqTail, __ATOMIC_RELAXED) + unsubmitted - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE));
+        }
+
+        //The caller keeps at most entries() requests in flight, so there is always a free slot
+        io_uring_sqe& prepare(uint8_t opcode, int fd, uint64_t userData) {
+            unsigned tail = __atomic_load_n(sqTail, __ATOMIC_RELAXED) + unsubmitted;
+            unsigned index = tail & sqMask;
+            io_uring_sqe& sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode;
+            sqe.fd = fd;
+            sqe.user_data = userData;
+            sqArray[index] = index;
+            ++unsubmitted;
+            return sqe;
+        }
+
+        //Submits prepared requests and waits for at least one completion. Requests the kernel
+        //hasn't picked up yet (after an interruption or a failed call) are submitted again
+        bool submitAndWait() {
+            unsigned tail = __atomic_load_n(sqTail, __ATOMIC_RELAXED) + unsubmitted;
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+            unsubmitted = 0;
+            while (true) {
+                unsigned toSubmit = tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+                long result = syscall(__NR_io_uring_enter, ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (result >= 0)
+                    return true;
+                if (errno != EINTR)
+                    return false;
+            }
+        }
+
+        template <typename Handler>
+        void drainCompletions(Handler&& handler) {
+            unsigned head = __atomic_load_n(cqHead, __ATOMIC_RELAXED);
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = cqes[head & cqMask];
+                handler(cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+
+    private:
+        //Opcodes arrived over several kernel versions, the probe lists the ones this kernel has
+        bool supportsOps(std::initializer_list<uint8_t> ops) {
+            constexpr unsigned maxOps = 256;
+            std::vector<char> storage(sizeof(io_uring_probe) + maxOps * sizeof(io_uring_probe_op));
+            io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+            if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, maxOps) < 0)
+                return false;
+            for (uint8_t op : ops) {
+                if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                    return false;
+            }
+            return true;
+        }
+
+        void* mapRing(size_t bytes, unsigned long long offset) {
+            void* ring = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, static_cast<off_t>(offset));
+            return ring == MAP_FAILED ? nullptr : ring;
+        }
+
+        int ringFd = -1;
+        void* sqRing = nullptr;
+        void* cqRing = nullptr;
+        io_uring_sqe* sqes = nullptr;
+        size_t sqBytes = 0, cqBytes = 0, sqeBytes = 0;
+        unsigned* sqHead = nullptr;
+        unsigned* sqTail = nullptr;
+        unsigned* sqArray = nullptr;
+        unsigned sqMask = 0;
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned cqMask = 0;
+        io_uring_cqe* cqes = nullptr;
+        unsigned capacity = 0;
+        unsigned unsubmitted = 0;
+    };
+#endif
+
+    //Hands finished files from the reading thread to the parsing threads
+    class DeliveryQueue {
+    public:
+        struct Item {
+            size_t index;
+            std::vector<char> contents;
+            bool ok;
+        };
+
+        void push(Item item) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                items.push_back(std::move(item));
+            }
+            ready.notify_one();
+        }
+
+        //No more items will be pushed, pop returns false once the queue is empty
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            ready.notify_all();
+        }
+
+        bool pop(Item& item) {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&]() { return closed || !items.empty(); });
+            if (items.empty())
+                return false;
+            item = std::move(items.front());
+            items.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<Item> items;
+        bool closed = false;
+    };
+}
+
+void BatchFileReader::readAll(const std::vector<std::string>& paths, const Callback& onRead, unsigned maxInFlight) {
+    if (paths.empty())
+        return;
+    if (!readAllWithIoUring(paths, onRead, maxInFlight))
+        readAllWithThreads(paths, onRead, maxInFlight);
+}
+
+void BatchFileReader::readAllWithThreads(const std::vector<std::string>& paths, const Callback& onRead, unsigned maxInFlight) {
+    //Blocking reads, so more threads than cores: most of them are waiting on the filesystem
+    size_t threadCount = std::min<size_t>(std::max(1u, maxInFlight), paths.size());
+    std::atomic<size_t> next{ 0 };
+
+    auto worker = [&]() {
+        std::vector<char> contents;
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            bool ok = readFile(paths[i], contents);
+            onRead(i, contents, ok);
+            contents.clear();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threadCount; ++t)
+        workers.emplace_back(worker);
+    worker();
+    for (std::thread& w : workers)
+        w.join();
+}
+
+bool BatchFileReader::readFile(const std::string& path, std::vector<char>& contents) {
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    contents.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    return static_cast<bool>(file.read(contents.data(), static_cast<std::streamsize>(contents.size())));
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0;
+    if (ok) {
+        contents.resize(static_cast<size_t>(info.st_size));
+        size_t done = 0;
+        while (done < contents.size()) {
+            ssize_t result = pread(fd, contents.data() + done, contents.size() - done, static_cast<off_t>(done));
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result <= 0)
+                break;
+            done += static_cast<size_t>(result);
+        }
+        //A file that shrank while being read keeps what was there
+        contents.resize(done);
+        ok = done == static_cast<size_t>(info.st_size) || done > 0;
+    }
+    ::close(fd);
+    return ok;
+#endif
+}
+
+bool BatchFileReader::readAllWithIoUring(const std::vector<std::string>& paths, const Callback& onRead, unsigned maxInFlight) {
+#ifndef STLVIEWER_HAS_IO_URING
+    return false;
+#else
+    //Seccomp profiles and older kernels often refuse io_uring, the thread pool takes over then
+    IoUring ring;
+    if (!ring.init(std::max(1u, std::min(maxInFlight, 4096u))))
+        return false;
+
+    //Every file goes open -> statx -> read (until complete) -> close, with one request in flight per file
+    enum class Stage { Open, Stat, Read, Close };
+    struct FileState {
+        Stage stage = Stage::Open;
+        int fd = -1;
+        bool failed = false;
+        size_t done = 0;
+        struct statx info;
+        std::vector<char> contents;
+    };
+
+    //Parsing runs on other threads so the ring keeps being refilled
+    DeliveryQueue queue;
+    std::vector<std::thread> parsers;
+    size_t parserCount = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t t = 0; t < parserCount; ++t) {
+        parsers.emplace_back([&]() {
+            DeliveryQueue::Item item;
+            while (queue.pop(item))
+                onRead(item.index, item.contents, item.ok);
+        });
+    }
+
+    std::vector<FileState> files(std::min<size_t>(ring.entries(), paths.size()));
+    std::vector<size_t> fileOfSlot(files.size());
+    std::vector<size_t> freeSlots;
+    for (size_t s = files.size(); s-- > 0;)
+        freeSlots.push_back(s);
+
+    //Reads are issued in pieces below 2 GB, the most a single read returns
+    const size_t maxRead = size_t(1) << 30;
+
+    auto submitRead = [&](size_t slot) {
+        FileState& file = files[slot];
+        file.stage = Stage::Read;
+        io_uring_sqe& sqe = ring.prepare(IORING_OP_READ, file.fd, slot);
+        sqe.addr = reinterpret_cast<uint64_t>(file.contents.data() + file.done);
+        sqe.len = static_cast<uint32_t>(std::min(maxRead, file.contents.size() - file.done));
+        sqe.off = file.done;
+    };
+
+    auto submitClose = [&](size_t slot) {
+        FileState& file = files[slot];
+        file.stage = Stage::Close;
+        ring.prepare(IORING_OP_CLOSE, file.fd, slot);
+    };
+
+    auto deliver = [&](size_t slot) {
+        FileState& file = files[slot];
+        queue.push(DeliveryQueue::Item{ fileOfSlot[slot], std::move(file.contents), !file.failed });
+        file = FileState();
+        freeSlots.push_back(slot);
+    };
+
+    size_t nextFile = 0;
+    size_t inFlight = 0;
+    bool ringFailed = false;
+    while (nextFile < paths.size() || inFlight > 0) {
+        //Start new files in every free slot
+        while (nextFile < paths.size() && !freeSlots.empty()) {
+            size_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            fileOfSlot[slot] = nextFile;
+            io_uring_sqe& sqe = ring.prepare(IORING_OP_OPENAT, AT_FDCWD, slot);
+            sqe.addr = reinterpret_cast<uint64_t>(paths[nextFile].c_str());
+            sqe.open_flags = O_RDONLY | O_CLOEXEC;
+            ++nextFile;
+            ++inFlight;
+        }
+
+        if (!ring.submitAndWait()) {
+            std::cout << "io_uring stopped working (" << std::strerror(errno) << "), reading the remaining files with threads" << std::endl;
+            ringFailed = true;
+            break;
+        }
+
+        ring.drainCompletions([&](uint64_t userData, int result) {
+            size_t slot = static_cast<size_t>(userData);
+            FileState& file = files[slot];
+            switch (file.stage) {
+            case Stage::Open:
+                if (result < 0) {
+                    file.failed = true;
+                    --inFlight;
+                    deliver(slot);
+                    return;
+                }
+                file.fd = result;
+                file.stage = Stage::Stat;
+                {
+                    io_uring_sqe& sqe = ring.prepare(IORING_OP_STATX, file.fd, slot);
+                    sqe.addr = reinterpret_cast<uint64_t>("");
+                    sqe.len = STATX_SIZE;
+                    sqe.statx_flags = AT_EMPTY_PATH;
+                    sqe.off = reinterpret_cast<uint64_t>(&file.info);
+                }
+                return;
+            case Stage::Stat:
+                if (result < 0) {
+                    file.failed = true;
+                    submitClose(slot);
+                    return;
+                }
+                file.contents.resize(static_cast<size_t>(file.info.stx_size));
+                if (file.contents.empty())
+                    submitClose(slot);
+                else
+                    submitRead(slot);
+                return;
+            case Stage::Read:
+                if (result == -EINTR || result == -EAGAIN) {
+                    submitRead(slot);
+                    return;
+                }
+                if (result <= 0) {
+                    //Error, or the file shrank: keep what was read
+                    file.failed = result < 0 || file.done == 0;
+                    file.contents.resize(file.done);
+                    submitClose(slot);
+                    return;
+                }
+                file.done += static_cast<size_t>(result);
+                if (file.done < file.contents.size())
+                    submitRead(slot);
+                else
+                    submitClose(slot);
+                return;
+            case Stage::Close:
+                --inFlight;
+                deliver(slot);
+                return;
+            }
+        });
+    }
+
+    if (ringFailed) {
+        //Files already finished have been delivered, the rest are read the blocking way.
+        //Requests still in the ring would complete into their slot's buffers, so they are
+        //cancelled and waited for first, then every descriptor they left open is closed
+        std::vector<std::string> remaining;
+        std::vector<size_t> remainingIndex;
+        std::vector<bool> pending(files.size(), false);
+        for (size_t slot = 0; slot < files.size(); ++slot) {
+            bool busy = std::find(freeSlots.begin(), freeSlots.end(), slot) == freeSlots.end();
+            if (busy) {
+                pending[slot] = true;
+                remaining.push_back(paths[fileOfSlot[slot]]);
+                remainingIndex.push_back(fileOfSlot[slot]);
+            }
+        }
+        for (; nextFile < paths.size(); ++nextFile) {
+            remaining.push_back(paths[nextFile]);
+            remainingIndex.push_back(nextFile);
+        }
+
+        //Cancellations are tagged so their own completions can be told apart from the slots'
+        const uint64_t cancelTag = uint64_t(1) << 63;
+        for (size_t slot = 0; slot < files.size() && ring.freeEntries() > 0; ++slot) {
+            if (pending[slot])
+                ring.prepare(IORING_OP_ASYNC_CANCEL, -1, cancelTag | slot).addr = slot;
+        }
+
+        //Cancelled or not, every request still completes once. Transient errors (full completion
+        //queue, no memory) clear up as completions are drained
+        while (inFlight > 0) {
+            bool waited = ring.submitAndWait();
+            if (!waited && errno != EBUSY && errno != EAGAIN && errno != ENOMEM)
+                break;
+            ring.drainCompletions([&](uint64_t userData, int result) {
+                if (userData & cancelTag)
+                    return;
+                size_t slot = static_cast<size_t>(userData);
+                FileState& file = files[slot];
+                if (file.stage == Stage::Open && result >= 0)
+                    file.fd = result;
+                else if (file.stage == Stage::Close && result != -ECANCELED)
+                    file.fd = -1;
+                pending[slot] = false;
+                --inFlight;
+            });
+            if (!waited)
+                std::this_thread::yield();
+        }
+
+        //A close still in the ring owns its descriptor
+        for (size_t slot = 0; slot < files.size(); ++slot) {
+            if (files[slot].fd >= 0 && !(pending[slot] && files[slot].stage == Stage::Close))
+                ::close(files[slot].fd);
+        }
+        //Only if the ring refused to be waited on: its requests may still write into the buffers
+        if (inFlight > 0)
+            new std::vector<FileState>(std::move(files));
+
+        readAllWithThreads(remaining, [&](size_t index, std::vector<char>& contents, bool ok) {
+            onRead(remainingIndex[index], contents, ok);
+        }, maxInFlight);
+    }
+
+    queue.close();
+    for (std::thread& parser : parsers)
+        parser.join();
+    return true;
+#endif
+}
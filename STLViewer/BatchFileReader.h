@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+//Reads many whole files with their open/read latencies overlapped, for loading
+//large numbers of small files (e.g. from a network filesystem).
+//On Linux reads are batched through io_uring when the kernel allows it,
+//otherwise a pool of threads does blocking reads (pread on POSIX)
+class BatchFileReader {
+public:
+    //Called once per file with its whole contents. ok is false if the file couldn't be read.
+    //Calls come from several threads at once, the contents may be moved out
+    using Callback = std::function<void(size_t index, std::vector<char>& contents, bool ok)>;
+
+    //Returns once every file has been delivered. maxInFlight limits the files being read at a time
+    static void readAll(const std::vector<std::string>& paths, const Callback& onRead, unsigned maxInFlight = 64);
+
+    //Only the thread pool, also used when io_uring isn't available
+    static void readAllWithThreads(const std::vector<std::string>& paths, const Callback& onRead, unsigned maxInFlight = 64);
+
+private:
+    //Returns false without reading anything if io_uring can't be set up
+    static bool readAllWithIoUring(const std::vector<std::string>& paths, const Callback& onRead, unsigned maxInFlight);
+    static bool readFile(const std::string& path, std::vector<char>& contents);
+};
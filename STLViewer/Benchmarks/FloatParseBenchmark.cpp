@@ -0,0 +1,107 @@
+//Times TextScanner::nextFloat against std::from_chars and std::strtof on the numbers of an ASCII STL file.
+//Usage: FloatParseBenchmark [file.stl] [repetitions]
+#include "MappedFile.h"
+#include "TextScanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    //Every numeric token of the file, each followed by a '\0' so strtof can read it in place
+    struct Corpus {
+        std::string text;
+        std::vector<size_t> starts;
+    };
+
+    Corpus collectNumbers(const char* data, size_t size) {
+        Corpus corpus;
+        TextScanner scanner{ data, data + size };
+        while (true) {
+            std::string_view word = scanner.nextWord();
+            if (word.empty())
+                break;
+            char c = word.front();
+            if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.') {
+                corpus.starts.push_back(corpus.text.size());
+                corpus.text.append(word);
+                corpus.text.push_back('\0');
+            }
+        }
+        return corpus;
+    }
+
+    //Best of several runs, in milliseconds; parse(token, tokenEnd) returns the float
+    template<typename Parse>
+    double bestTime(const Corpus& corpus, int repetitions, std::vector<float>& values, Parse&& parse) {
+        double best = 1e30;
+        values.resize(corpus.starts.size());
+        for (int r = 0; r < repetitions; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < corpus.starts.size(); ++i) {
+                const char* token = corpus.text.data() + corpus.starts[i];
+                values[i] = parse(token, token + std::strlen(token));
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    size_t countMismatches(const std::vector<float>& a, const std::vector<float>& b) {
+        size_t mismatches = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+            mismatches += std::memcmp(&a[i], &b[i], sizeof(float)) != 0;
+        return mismatches;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "Resources/Sphericon.stl";
+    int repetitions = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20;
+
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        std::cout << "Can't open file: " << path << std::endl;
+        return 1;
+    }
+    Corpus corpus = collectNumbers(file.data(), file.size());
+    if (corpus.starts.empty()) {
+        std::cout << "No numbers found, the benchmark needs an ASCII STL file" << std::endl;
+        return 1;
+    }
+
+    size_t fastPathHits = 0;
+    for (size_t start : corpus.starts) {
+        const char* token = corpus.text.data() + start;
+        TextScanner scanner{ token + (*token == '+'), token + std::strlen(token) };
+        float value;
+        fastPathHits += scanner.parseShortFloat(value);
+    }
+
+    std::vector<float> scanned, fromChars, strtofValues;
+    double scannerTime = bestTime(corpus, repetitions, scanned, [](const char* token, const char* tokenEnd) {
+        TextScanner scanner{ token, tokenEnd };
+        return scanner.nextFloat();
+    });
+    double fromCharsTime = bestTime(corpus, repetitions, fromChars, [](const char* token, const char* tokenEnd) {
+        float value = 0.0f;
+        std::from_chars(token + (*token == '+'), tokenEnd, value);
+        return value;
+    });
+    double strtofTime = bestTime(corpus, repetitions, strtofValues, [](const char* token, const char*) {
+        return std::strtof(token, nullptr);
+    });
+
+    std::cout << path << ": " << corpus.starts.size() << " numbers, "
+        << fastPathHits << " on the fast path, best of " << repetitions << " runs" << std::endl;
+    std::cout << "TextScanner::nextFloat " << scannerTime << " ms, "
+        << countMismatches(scanned, fromChars) << " results differ from from_chars" << std::endl;
+    std::cout << "std::from_chars        " << fromCharsTime << " ms" << std::endl;
+    std::cout << "std::strtof            " << strtofTime << " ms, "
+        << countMismatches(strtofValues, fromChars) << " results differ from from_chars" << std::endl;
+    return 0;
+}
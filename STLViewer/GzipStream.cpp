@@ -0,0 +1,119 @@
+#include "GzipStream.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef STLVIEWER_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+bool GzipStream::isGzip(const char* data, size_t size) {
+    return size >= 18 && static_cast<unsigned char>(data[0]) == 0x1F && static_cast<unsigned char>(data[1]) == 0x8B;
+}
+
+uint32_t GzipStream::uncompressedSizeHint(const char* data, size_t size) {
+    if (size < 4)
+        return 0;
+    uint32_t isize;
+    std::memcpy(&isize, data + size - 4, sizeof(isize));
+    return isize;
+}
+
+#ifdef STLVIEWER_WITH_ZLIB
+
+struct GzipStream::State {
+    z_stream stream{};
+    const unsigned char* input = nullptr;
+    size_t inputSize = 0;
+    size_t inputOffset = 0; //Bytes already handed to zlib
+};
+
+GzipStream::GzipStream(const char* data, size_t size)
+    : state(std::make_unique<State>()) {
+    state->input = reinterpret_cast<const unsigned char*>(data);
+    state->inputSize = size;
+
+    //15 window bits + 32: accept gzip or zlib headers
+    if (inflateInit2(&state->stream, 15 + 32) != Z_OK) {
+        std::cout << "Can't initialize zlib" << std::endl;
+        failed = true;
+    }
+}
+
+GzipStream::~GzipStream() {
+    inflateEnd(&state->stream);
+}
+
+bool GzipStream::isAvailable() {
+    return true;
+}
+
+size_t GzipStream::compressedBytesConsumed() const {
+    return state->inputOffset - state->stream.avail_in;
+}
+
+size_t GzipStream::read(char* out, size_t capacity) {
+    if (failed || finished)
+        return 0;
+
+    z_stream& stream = state->stream;
+    stream.next_out = reinterpret_cast<Bytef*>(out);
+    stream.avail_out = static_cast<uInt>(std::min<size_t>(capacity, 1u << 30));
+
+    while (stream.avail_out > 0) {
+        //zlib counts input in 32-bit units, so feed huge mappings in slices
+        if (stream.avail_in == 0 && state->inputOffset < state->inputSize) {
+            size_t slice = std::min<size_t>(state->inputSize - state->inputOffset, 1u << 30);
+            stream.next_in = const_cast<Bytef*>(state->input + state->inputOffset);
+            stream.avail_in = static_cast<uInt>(slice);
+            state->inputOffset += slice;
+        }
+
+        int result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            //Concatenated gzip members decode as one stream
+            if (stream.avail_in == 0 && state->inputOffset == state->inputSize) {
+                finished = true;
+                break;
+            }
+            inflateReset(&stream);
+        }
+        else if (result == Z_BUF_ERROR && stream.avail_in == 0 && state->inputOffset == state->inputSize) {
+            std::cout << "Compressed file is truncated" << std::endl;
+            failed = true;
+            break;
+        }
+        else if (result != Z_OK && result != Z_BUF_ERROR) {
+            std::cout << "Decompression failed: " << (stream.msg ? stream.msg : "unknown error") << std::endl;
+            failed = true;
+            break;
+        }
+    }
+
+    return static_cast<size_t>(reinterpret_cast<char*>(stream.next_out) - out);
+}
+
+#else
+
+struct GzipStream::State {};
+
+GzipStream::GzipStream(const char*, size_t)
+    : failed(true) {
+    std::cout << "Compressed files need zlib, this build was made without it" << std::endl;
+}
+
+GzipStream::~GzipStream() = default;
+
+bool GzipStream::isAvailable() {
+    return false;
+}
+
+size_t GzipStream::compressedBytesConsumed() const {
+    return 0;
+}
+
+size_t GzipStream::read(char*, size_t) {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//Incremental gzip decompression of an in-memory buffer (typically a MappedFile).
+//Needs zlib at build time (STLVIEWER_WITH_ZLIB), otherwise every stream reports an error
+class GzipStream {
+public:
+    GzipStream(const char* data, size_t size);
+    ~GzipStream();
+
+    GzipStream(const GzipStream&) = delete;
+    GzipStream& operator=(const GzipStream&) = delete;
+
+    static bool isAvailable();
+    static bool isGzip(const char* data, size_t size);
+
+    //Uncompressed size from the gzip trailer. Only the low 32 bits are stored, and only for the last member
+    static uint32_t uncompressedSizeHint(const char* data, size_t size);
+
+    //Decompresses up to capacity bytes into out. Returns the number of bytes produced, 0 at the end of the data
+    size_t read(char* out, size_t capacity);
+
+    bool hasError() const { return failed; }
+    size_t compressedBytesConsumed() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+    bool failed = false;
+    bool finished = false;
+};
@@ -0,0 +1,171 @@
+#include "HalfEdgeMesh.h"
+#include <algorithm>
+#include <thread>
+
+namespace {
+    //Below this many items per thread, starting threads costs more than it saves
+    const size_t MIN_ITEMS_PER_THREAD = 1 << 16;
+
+    //Runs work(first, last) over [0, count) split into contiguous ranges, one per thread
+    template<typename Work>
+    void parallelRanges(size_t count, const Work& work) {
+        size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::min(threadCount, std::max<size_t>(1, count / MIN_ITEMS_PER_THREAD));
+
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threadCount; ++t)
+            workers.emplace_back(work, count * t / threadCount, count * (t + 1) / threadCount);
+        work(0, count / threadCount);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+}
+
+std::shared_ptr<HalfEdgeMesh> HalfEdgeMesh::fromMesh(const Mesh& mesh) {
+    std::shared_ptr<HalfEdgeMesh> result = std::make_shared<HalfEdgeMesh>();
+    HalfEdgeMesh& he = *result;
+
+    const std::vector<uint32_t>& indices = mesh.getIndices();
+    const size_t halfEdgeCount = mesh.triangleCount() * 3;
+    const size_t vertexCount = mesh.vertexCount();
+
+    const PositionView positions = mesh.positionView();
+    he.positions.resize(positions.size());
+    for (size_t v = 0; v < positions.size(); ++v)
+        he.positions[v] = positions[v];
+    he.subMeshes = mesh.getSubMeshes();
+    he.twins.resize(halfEdgeCount);
+    he.nexts.resize(halfEdgeCount);
+    he.vertices.resize(halfEdgeCount);
+    he.faces.resize(halfEdgeCount);
+    he.faceHalfEdges.resize(mesh.triangleCount());
+    he.vertexHalfEdges.resize(vertexCount);
+
+    //Links inside a triangle follow from the numbering alone
+    parallelRanges(mesh.triangleCount(), [&](size_t first, size_t last) {
+        for (size_t f = first; f < last; ++f) {
+            uint32_t h = static_cast<uint32_t>(3 * f);
+            for (uint32_t e = 0; e < 3; ++e) {
+                he.nexts[h + e] = h + (e + 1) % 3;
+                he.vertices[h + e] = indices[h + (e + 1) % 3];
+                he.faces[h + e] = static_cast<uint32_t>(f);
+            }
+            he.faceHalfEdges[f] = h;
+        }
+    });
+
+    //Outgoing half-edges grouped by origin vertex (compressed rows), in half-edge order so the result is deterministic
+    std::vector<uint32_t> outgoingStart(vertexCount + 1, 0);
+    for (size_t h = 0; h < halfEdgeCount; ++h)
+        ++outgoingStart[indices[h] + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        outgoingStart[v + 1] += outgoingStart[v];
+
+    std::vector<uint32_t> outgoing(halfEdgeCount);
+    {
+        std::vector<uint32_t> cursor(outgoingStart.begin(), outgoingStart.end() - 1);
+        for (size_t h = 0; h < halfEdgeCount; ++h)
+            outgoing[cursor[indices[h]]++] = static_cast<uint32_t>(h);
+    }
+
+    //The twin of a->b is a half-edge b->a, looked up among b's outgoing half-edges.
+    //A half-edge only has a candidate when exactly one such match exists, and twins are kept only
+    //where the candidates are mutual, so every edge of a non-manifold fan is left unpaired
+    std::vector<uint32_t> candidates(halfEdgeCount);
+    parallelRanges(halfEdgeCount, [&](size_t first, size_t last) {
+        for (size_t h = first; h < last; ++h) {
+            uint32_t from = indices[h];
+            uint32_t to = he.vertices[h];
+            uint32_t match = INVALID;
+            for (uint32_t i = outgoingStart[to]; i < outgoingStart[to + 1]; ++i) {
+                if (he.vertices[outgoing[i]] == from) {
+                    if (match != INVALID) {
+                        match = INVALID;
+                        break;
+                    }
+                    match = outgoing[i];
+                }
+            }
+            candidates[h] = match;
+        }
+    });
+
+    parallelRanges(halfEdgeCount, [&](size_t first, size_t last) {
+        for (size_t h = first; h < last; ++h) {
+            uint32_t match = candidates[h];
+            he.twins[h] = (match != INVALID && candidates[match] == h) ? match : INVALID;
+        }
+    });
+
+    //Boundary vertices start at their boundary half-edge so a walk around them covers the whole fan
+    parallelRanges(vertexCount, [&](size_t first, size_t last) {
+        for (size_t v = first; v < last; ++v) {
+            uint32_t chosen = INVALID;
+            for (uint32_t i = outgoingStart[v]; i < outgoingStart[v + 1]; ++i) {
+                if (chosen == INVALID || he.twins[outgoing[i]] == INVALID)
+                    chosen = outgoing[i];
+                if (he.twins[chosen] == INVALID)
+                    break;
+            }
+            he.vertexHalfEdges[v] = chosen;
+        }
+    });
+
+    return result;
+}
+
+std::shared_ptr<Mesh> HalfEdgeMesh::toMesh() const {
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+    mesh->getPositions() = positions;
+    mesh->getSubMeshes() = subMeshes;
+
+    std::vector<uint32_t>& indices = mesh->getIndices();
+    indices.resize(faceHalfEdges.size() * 3);
+    parallelRanges(faceHalfEdges.size(), [&](size_t first, size_t last) {
+        for (size_t f = first; f < last; ++f) {
+            uint32_t h = faceHalfEdges[f];
+            indices[3 * f] = origin(h);
+            indices[3 * f + 1] = vertices[h];
+            indices[3 * f + 2] = vertices[nexts[h]];
+        }
+    });
+    return mesh;
+}
+
+size_t HalfEdgeMesh::valence(uint32_t v) const {
+    size_t count = 0;
+    forEachNeighbor(v, [&count](uint32_t) { ++count; });
+    return count;
+}
+
+uint32_t HalfEdgeMesh::nextBoundary(uint32_t h) const {
+    //Turn around the target vertex until the edge leaving it has no twin
+    uint32_t g = nexts[h];
+    while (twins[g] != INVALID)
+        g = nexts[twins[g]];
+    return g;
+}
+
+std::vector<std::vector<uint32_t>> HalfEdgeMesh::boundaryLoops() const {
+    std::vector<std::vector<uint32_t>> loops;
+    std::vector<bool> visited(twins.size(), false);
+
+    for (uint32_t h = 0; h < twins.size(); ++h) {
+        if (twins[h] != INVALID || visited[h])
+            continue;
+
+        std::vector<uint32_t> loop;
+        for (uint32_t g = h; !visited[g]; g = nextBoundary(g)) {
+            visited[g] = true;
+            loop.push_back(g);
+        }
+        loops.push_back(std::move(loop));
+    }
+    return loops;
+}
+
+size_t HalfEdgeMesh::memoryUsage() const {
+    return (twins.capacity() + nexts.capacity() + vertices.capacity() + faces.capacity() +
+            vertexHalfEdges.capacity() + faceHalfEdges.capacity()) * sizeof(uint32_t) +
+           positions.capacity() * sizeof(glm::vec3);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <glm.hpp>
+#include "Mesh.h"
+
+//Index-based half-edge structure of a triangle mesh, for local topology queries
+//(one-ring neighbours, valence, boundary walking) in constant time per step.
+//Half-edge 3f+e belongs to triangle f and runs from its corner e to corner e+1,
+//every link is an index into the arrays below, there are no pointers
+class HalfEdgeMesh {
+public:
+    static constexpr uint32_t INVALID = 0xFFFFFFFFu;
+
+    //Builds the structure from the mesh's triangles, matching twins on several threads.
+    //Positions of quantized meshes are decoded. Edges shared by more than two triangles,
+    //or by two with opposite winding, are left unpaired
+    static std::shared_ptr<HalfEdgeMesh> fromMesh(const Mesh& mesh);
+
+    //Triangles come back in their original order and winding, with the same vertex numbering and parts
+    std::shared_ptr<Mesh> toMesh() const;
+
+    // Per half-edge links
+    uint32_t twin(uint32_t h) const { return twins[h]; }
+    uint32_t next(uint32_t h) const { return nexts[h]; }
+    uint32_t prev(uint32_t h) const { return nexts[nexts[h]]; }
+    uint32_t vertex(uint32_t h) const { return vertices[h]; } //The vertex the half-edge points to
+    uint32_t origin(uint32_t h) const { return vertices[prev(h)]; }
+    uint32_t face(uint32_t h) const { return faces[h]; }
+    bool isBoundary(uint32_t h) const { return twins[h] == INVALID; }
+
+    //An outgoing half-edge of the vertex (a boundary one if the vertex is on the boundary),
+    //INVALID for vertices no triangle uses
+    uint32_t vertexHalfEdge(uint32_t v) const { return vertexHalfEdges[v]; }
+    uint32_t faceHalfEdge(uint32_t f) const { return faceHalfEdges[f]; }
+    bool isBoundaryVertex(uint32_t v) const { return vertexHalfEdges[v] != INVALID && isBoundary(vertexHalfEdges[v]); }
+
+    //Calls visit(h) for each outgoing half-edge of v, walking around v from vertexHalfEdge(v).
+    //On a non-manifold vertex only the fan containing vertexHalfEdge(v) is visited
+    template<typename Visitor>
+    void forEachOutgoing(uint32_t v, Visitor&& visit) const {
+        uint32_t start = vertexHalfEdges[v];
+        if (start == INVALID)
+            return;
+        uint32_t h = start;
+        do {
+            visit(h);
+            h = twins[prev(h)];
+        } while (h != INVALID && h != start);
+    }
+
+    //Calls visit(u) for each vertex u sharing an edge with v
+    template<typename Visitor>
+    void forEachNeighbor(uint32_t v, Visitor&& visit) const {
+        uint32_t last = INVALID;
+        forEachOutgoing(v, [&](uint32_t h) {
+            visit(vertices[h]);
+            last = h;
+        });
+        //An open fan has one more neighbour, across the edge the walk stopped at
+        if (last != INVALID && isBoundary(prev(last)))
+            visit(vertices[nexts[last]]);
+    }
+
+    size_t valence(uint32_t v) const;
+
+    //Every hole (closed loop of boundary half-edges), each in walking order
+    std::vector<std::vector<uint32_t>> boundaryLoops() const;
+
+    std::vector<glm::vec3>& getPositions() { return positions; }
+    const std::vector<glm::vec3>& getPositions() const { return positions; }
+
+    size_t halfEdgeCount() const { return twins.size(); }
+    size_t vertexCount() const { return positions.size(); }
+    size_t faceCount() const { return faceHalfEdges.size(); }
+    size_t memoryUsage() const;
+
+private:
+    std::vector<uint32_t> twins;
+    std::vector<uint32_t> nexts;
+    std::vector<uint32_t> vertices;
+    std::vector<uint32_t> faces;
+    std::vector<uint32_t> vertexHalfEdges;
+    std::vector<uint32_t> faceHalfEdges;
+    std::vector<glm::vec3> positions;
+    std::vector<SubMesh> subMeshes;
+
+    //The half-edge after h around its target vertex that lies on the boundary, h must be a boundary half-edge
+    uint32_t nextBoundary(uint32_t h) const;
+};
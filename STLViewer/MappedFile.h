@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+//Read-only memory mapping of a whole file (mmap on POSIX, file mapping on Windows)
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& filename);
+    void close();
+
+    // Access
+    bool isOpen() const { return opened; }
+    const char* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+
+private:
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
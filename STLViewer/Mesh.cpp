@@ -1,14 +1,34 @@
 #include "Mesh.h"
+#include <atomic>
 
-void Mesh::addVertex(const Vertex& vertex) {
-    vertices.emplace_back(vertex);
+uint64_t QuantizedVertices::nextGeneration() {
+    static std::atomic<uint64_t> counter{ 0 };
+    return ++counter;
 }
 
-void Mesh::addTriangle(const Triangle& tri) {
-    triangles.push_back(tri);
+void Mesh::addVertex(const glm::vec3& position) {
+    positions.push_back(position);
+}
+
+void Mesh::addTriangle(uint32_t a, uint32_t b, uint32_t c) {
+    indices.push_back(a);
+    indices.push_back(b);
+    indices.push_back(c);
+    topology.reset();
+}
+
+void Mesh::reserve(size_t vertexCapacity, size_t triangleCapacity) {
+    positions.reserve(vertexCapacity);
+    indices.reserve(triangleCapacity * 3);
 }
 
 void Mesh::clear() {
-    vertices.clear();
-    triangles.clear();
+    positions.clear();
+    normals.clear();
+    indices.clear();
+    faceNormals.clear();
+    topology.reset();
+    subMeshes.clear();
+    lattice = PositionLattice();
+    quantized = QuantizedVertices();
 }
\ No newline at end of file
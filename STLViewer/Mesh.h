@@ -1,44 +1,191 @@
 #pragma once
 #include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <cmath>
+#include <algorithm>
 #include <glm.hpp>
+#include <gtc/type_precision.hpp>
 
-struct Vertex {
-    glm::vec3 position{ 0.0f, 0.0f, 0.0f }; 
-    glm::vec3 normal{ 0.0f, 0.0f, 0.0f };
+//Named part of a mesh (e.g. one solid of a multi-solid STL), covering contiguous ranges.
+//Triangles of a part only reference vertices inside the part's vertex range
+struct SubMesh {
+    std::string name;
+    size_t firstVertex = 0;
+    size_t vertexCount = 0;
+    size_t firstTriangle = 0;
+    size_t triangleCount = 0;
 };
 
-struct Triangle {
-    int v1, v2, v3; // Vertex indices
-    int adjacentTriangles[3] = { -1, -1, -1 }; // Optional adjacency info
-    glm::vec3 faceNormal{ 0.0f, 0.0f, 0.0f };
+//Integer lattice the positions were snapped to, see MeshOperations::snapToLattice.
+//A vertex's key packs its cell index along x, y and z in 21 bits each, so equal keys mean equal positions
+struct PositionLattice {
+    static constexpr int AXIS_BITS = 21;
+    static constexpr uint64_t AXIS_CELLS = uint64_t(1) << AXIS_BITS;
 
-	// Constructor for easy initialization
-    Triangle(int a, int b, int c, glm::vec3 inNormal)
-        : v1(a), v2(b), v3(c), faceNormal(inNormal) {
+    glm::vec3 origin{ 0.0f, 0.0f, 0.0f };
+    float spacing = 0.0f;
+    std::vector<uint64_t> keys; //One per vertex, empty when positions aren't snapped
+};
+
+//Compact vertex storage for very large meshes, see MeshOperations::quantizeVertices.
+//Positions are 16-bit fractions of the bounding box per axis (6 bytes instead of 12),
+//normals are octahedral-encoded into two signed 16-bit values (4 bytes instead of 12)
+struct QuantizedVertices {
+    static constexpr float POSITION_STEPS = 65535.0f;
+    static constexpr float NORMAL_STEPS = 32767.0f;
+
+    glm::vec3 origin{ 0.0f, 0.0f, 0.0f }; //position = origin + extent * q / POSITION_STEPS
+    glm::vec3 extent{ 0.0f, 0.0f, 0.0f };
+    std::vector<glm::u16vec3> positions;
+    std::vector<glm::i16vec2> normals; //Empty when the mesh had no normals
+    uint64_t generation = 0; //Renewed from nextGeneration() whenever the data above is rewritten
+
+    //Process-wide counter, so no two quantized states share a generation
+    static uint64_t nextGeneration();
+
+    glm::vec3 decodePosition(size_t i) const {
+        return origin + extent * (glm::vec3(positions[i]) / POSITION_STEPS);
     }
-    Triangle() = default; //Default Constructor
 
+    //Folds the unit sphere onto the octahedron |x| + |y| + |z| = 1 and unfolds that into a square
+    static glm::i16vec2 encodeNormal(const glm::vec3& n) {
+        float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (sum == 0.0f)
+            return glm::i16vec2(0, 0);
+        glm::vec2 p = glm::vec2(n.x, n.y) / sum;
+        if (n.z < 0.0f) {
+            p = glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                          (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+        }
+        return glm::i16vec2(glm::round(glm::clamp(p, -1.0f, 1.0f) * NORMAL_STEPS));
+    }
+
+    static glm::vec3 decodeNormal(const glm::i16vec2& e) {
+        glm::vec2 p = glm::vec2(e) / NORMAL_STEPS;
+        glm::vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+        float fold = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -fold : fold;
+        n.y += n.y >= 0.0f ? -fold : fold;
+        return glm::normalize(n);
+    }
 };
 
+//Read-only access to a vertex attribute whichever storage the mesh uses, decoding quantized values on access
+class PositionView {
+public:
+    explicit PositionView(const std::vector<glm::vec3>& positions) : positions(&positions) {}
+    explicit PositionView(const QuantizedVertices& quantized) : quantized(&quantized) {}
+
+    glm::vec3 operator[](size_t i) const { return quantized ? quantized->decodePosition(i) : (*positions)[i]; }
+    size_t size() const { return quantized ? quantized->positions.size() : positions->size(); }
+
+private:
+    const std::vector<glm::vec3>* positions = nullptr;
+    const QuantizedVertices* quantized = nullptr;
+};
+
+class NormalView {
+public:
+    explicit NormalView(const std::vector<glm::vec3>& normals) : normals(&normals) {}
+    explicit NormalView(const QuantizedVertices& quantized) : quantized(&quantized) {}
+
+    glm::vec3 operator[](size_t i) const {
+        return quantized ? QuantizedVertices::decodeNormal(quantized->normals[i]) : (*normals)[i];
+    }
+    size_t size() const { return quantized ? quantized->normals.size() : normals->size(); }
+
+private:
+    const std::vector<glm::vec3>* normals = nullptr;
+    const QuantizedVertices* quantized = nullptr;
+};
+
+//Face-to-face adjacency, built on demand by MeshOperations and attached to a Mesh.
+//Kept out of the mesh arrays so meshes that are only viewed or exported never pay for it
+class MeshTopology {
+public:
+    static constexpr int NO_NEIGHBOR = -1;
+
+    explicit MeshTopology(size_t triangleCount) : adjacency(triangleCount * 3, NO_NEIGHBOR) {}
+
+    //Three neighbouring triangles per triangle, one per edge (v1-v2, v2-v3, v3-v1)
+    std::vector<int>& getAdjacency() { return adjacency; }
+    const std::vector<int>& getAdjacency() const { return adjacency; }
+    const int* neighbors(size_t t) const { return adjacency.data() + 3 * t; }
+
+    size_t triangleCount() const { return adjacency.size() / 3; }
+    size_t memoryUsage() const { return adjacency.capacity() * sizeof(int); }
+
+private:
+    std::vector<int> adjacency;
+};
+
+//Triangle mesh stored as separate arrays (structure of arrays), so passes over one
+//attribute don't drag the others through the cache
 class Mesh {
 public:
     // Basic operations
-    void addVertex(const Vertex& vertex);
-    void addTriangle(const Triangle& tri);
+    void addVertex(const glm::vec3& position);
+    void addTriangle(uint32_t a, uint32_t b, uint32_t c);
+    void reserve(size_t vertexCapacity, size_t triangleCapacity);
+
+    // Vertex attributes. Normals are either empty (not computed yet) or one per vertex.
+    // Both are empty while the mesh is quantized, read through positionView()/normalView() to handle either storage
+    std::vector<glm::vec3>& getPositions() { return positions; }
+    std::vector<glm::vec3>& getNormals() { return normals; }
+    const std::vector<glm::vec3>& getPositions() const { return positions; }
+    const std::vector<glm::vec3>& getNormals() const { return normals; }
+
+    // Three vertex indices per triangle. Callers that rewire triangles through this
+    // must discardTopology() afterwards
+    std::vector<uint32_t>& getIndices() { return indices; }
+    const std::vector<uint32_t>& getIndices() const { return indices; }
+    const uint32_t* triangle(size_t t) const { return indices.data() + 3 * t; }
+
+    // Face attributes, each either empty or one entry per triangle
+    std::vector<glm::vec3>& getFaceNormals() { return faceNormals; }
+    const std::vector<glm::vec3>& getFaceNormals() const { return faceNormals; }
+
+    PositionView positionView() const { return isQuantized() ? PositionView(quantized) : PositionView(positions); }
+    NormalView normalView() const { return isQuantized() ? NormalView(quantized) : NormalView(normals); }
+
+    // Quantized storage, replaces positions and normals after MeshOperations::quantizeVertices
+    QuantizedVertices& getQuantized() { return quantized; }
+    const QuantizedVertices& getQuantized() const { return quantized; }
+    bool isQuantized() const { return !quantized.positions.empty(); }
+
+    bool hasNormals() const { return vertexCount() > 0 && normalView().size() == vertexCount(); }
+    bool hasFaceNormals() const { return triangleCount() > 0 && faceNormals.size() == triangleCount(); }
+
+    // Topology side table, nullptr until MeshOperations builds it (see MeshOperations::getTopology).
+    // Adding triangles drops it, discardTopology() frees it once it's no longer needed
+    const MeshTopology* getTopology() const { return topology.get(); }
+    void setTopology(std::shared_ptr<const MeshTopology> built) { topology = std::move(built); }
+    void discardTopology() { topology.reset(); }
+    bool hasTopology() const { return topology && topology->triangleCount() == triangleCount(); }
+
+    //Empty when the whole mesh is a single part
+    std::vector<SubMesh>& getSubMeshes() { return subMeshes; }
+    const std::vector<SubMesh>& getSubMeshes() const { return subMeshes; }
 
-    // Access
-    std::vector<Vertex>& getVertices() { return vertices; }
-    std::vector<Triangle>& getTriangles() { return triangles; }
-    const std::vector<Vertex>& getVertices() const { return vertices; }
-    const std::vector<Triangle>& getTriangles() const { return triangles; }  
+    PositionLattice& getLattice() { return lattice; }
+    const PositionLattice& getLattice() const { return lattice; }
 
     // Basic info
-    size_t vertexCount() const { return vertices.size(); }
-    size_t triangleCount() const { return triangles.size(); }
+    size_t vertexCount() const { return isQuantized() ? quantized.positions.size() : positions.size(); }
+    size_t triangleCount() const { return indices.size() / 3; }
+    size_t subMeshCount() const { return subMeshes.size(); }
 
     void clear();
 
 private:
-    std::vector<Vertex> vertices;
-    std::vector<Triangle> triangles;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<uint32_t> indices;
+    std::vector<glm::vec3> faceNormals;
+    std::shared_ptr<const MeshTopology> topology;
+    std::vector<SubMesh> subMeshes;
+    PositionLattice lattice;
+    QuantizedVertices quantized;
 };
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+namespace {
+    const char CACHE_MAGIC[8] = { 'S', 'T', 'L', 'V', 'C', 'A', 'C', 'H' };
+
+    uint64_t hashString(const std::string& text) {
+        //FNV-1a
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    //Only the options that change the loaded mesh, progress reporting doesn't
+    uint64_t hashOptions(const STLLoadOptions& options) {
+        std::string key;
+        auto append = [&key](const auto& value) {
+            key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+        append(options.weldVertices);
+        append(options.normals);
+        append(options.sampleFacets);
+        append(options.snapSpacing);
+        append(options.clipToRegion);
+        if (options.clipToRegion) {
+            append(options.regionMin);
+            append(options.regionMax);
+        }
+        return hashString(key);
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    //Byte views of the mesh arrays in section order, so load and save treat them all alike
+    struct ArrayView {
+        char* data;
+        size_t count;
+        size_t elementSize;
+    };
+
+    template<typename T>
+    ArrayView viewOf(std::vector<T>& array) {
+        return ArrayView{ reinterpret_cast<char*>(array.data()), array.size(), sizeof(T) };
+    }
+
+    std::vector<ArrayView> meshArrays(Mesh& mesh, std::vector<int>& adjacency) {
+        return { viewOf(mesh.getPositions()), viewOf(mesh.getNormals()), viewOf(mesh.getIndices()),
+                 viewOf(mesh.getFaceNormals()), viewOf(adjacency) };
+    }
+
+    //Element size of each section, in the order of meshArrays
+    const size_t SECTION_ELEMENT_SIZES[] = { sizeof(glm::vec3), sizeof(glm::vec3), sizeof(uint32_t), sizeof(glm::vec3), sizeof(int) };
+}
+
+std::string MeshCache::cachePathFor(const std::string& sourcePath) {
+    return sourcePath + ".meshcache";
+}
+
+bool MeshCache::makeKey(const std::string& sourcePath, const STLLoadOptions& options, Header& header) {
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::absolute(sourcePath, error);
+    if (error)
+        return false;
+
+    uint64_t size = std::filesystem::file_size(path, error);
+    if (error)
+        return false;
+
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error)
+        return false;
+
+    header.sourceSize = size;
+    header.sourceModified = static_cast<int64_t>(modified.time_since_epoch().count());
+    header.sourcePathHash = hashString(path.lexically_normal().string());
+    header.optionsHash = hashOptions(options);
+    return true;
+}
+
+std::shared_ptr<Mesh> MeshCache::load(const std::string& sourcePath, const STLLoadOptions& options) {
+    Header expected{};
+    if (!makeKey(sourcePath, options, expected))
+        return nullptr;
+
+    MappedFile file(cachePathFor(sourcePath));
+    if (!file.isOpen() || file.size() < sizeof(Header))
+        return nullptr;
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    //Reject caches from other versions, other builds, a changed source file or other load options
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.version != CACHE_VERSION ||
+        header.sourceSize != expected.sourceSize ||
+        header.sourceModified != expected.sourceModified ||
+        header.sourcePathHash != expected.sourcePathHash ||
+        header.optionsHash != expected.optionsHash) {
+        return nullptr;
+    }
+
+    //Sections must lie inside the file before anything is allocated for them, so a damaged
+    //header can't ask for arbitrary amounts of memory (division keeps the check overflow-free)
+    for (size_t i = 0; i < SECTION_COUNT; ++i) {
+        const Section& section = header.sections[i];
+        if (section.offset > file.size() || section.count > (file.size() - section.offset) / SECTION_ELEMENT_SIZES[i]) {
+            std::cout << "Mesh cache is truncated: " << cachePathFor(sourcePath) << std::endl;
+            return nullptr;
+        }
+    }
+    if (header.sections[2].count % 3 != 0)
+        return nullptr;
+
+    //Every array is stored in its in-memory layout, so this is one straight copy per array out of the mapping
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+    mesh->getPositions().resize(header.sections[0].count);
+    mesh->getNormals().resize(header.sections[1].count);
+    mesh->getIndices().resize(header.sections[2].count);
+    mesh->getFaceNormals().resize(header.sections[3].count);
+    std::shared_ptr<MeshTopology> topology = std::make_shared<MeshTopology>(header.sections[4].count / 3);
+
+    std::vector<ArrayView> arrays = meshArrays(*mesh, topology->getAdjacency());
+    for (size_t i = 0; i < SECTION_COUNT; ++i)
+        std::memcpy(arrays[i].data, file.data() + header.sections[i].offset, arrays[i].count * arrays[i].elementSize);
+
+    //Damaged indices would send the renderer and the topology code out of bounds
+    const size_t vertexCount = mesh->vertexCount();
+    const int triangleCount = static_cast<int>(mesh->triangleCount());
+    for (uint32_t index : mesh->getIndices()) {
+        if (index >= vertexCount) {
+            std::cout << "Mesh cache has invalid indices: " << cachePathFor(sourcePath) << std::endl;
+            return nullptr;
+        }
+    }
+    for (int neighbor : topology->getAdjacency()) {
+        if (neighbor < MeshTopology::NO_NEIGHBOR || neighbor >= triangleCount) {
+            std::cout << "Mesh cache has invalid adjacency: " << cachePathFor(sourcePath) << std::endl;
+            return nullptr;
+        }
+    }
+    if (topology->triangleCount() == mesh->triangleCount() && mesh->triangleCount() > 0)
+        mesh->setTopology(std::move(topology));
+
+    const char* cursor = file.data() + header.subMeshOffset;
+    const char* end = file.data() + file.size();
+    for (uint64_t i = 0; i < header.subMeshCount; ++i) {
+        uint64_t fields[5];
+        if (header.subMeshOffset > file.size() || end - cursor < static_cast<ptrdiff_t>(sizeof(fields)))
+            return nullptr;
+        std::memcpy(fields, cursor, sizeof(fields));
+        cursor += sizeof(fields);
+        if (static_cast<uint64_t>(end - cursor) < fields[4])
+            return nullptr;
+
+        if (fields[0] > vertexCount || fields[1] > vertexCount - fields[0] ||
+            fields[2] > mesh->triangleCount() || fields[3] > mesh->triangleCount() - fields[2])
+            return nullptr;
+
+        SubMesh part;
+        part.firstVertex = fields[0];
+        part.vertexCount = fields[1];
+        part.firstTriangle = fields[2];
+        part.triangleCount = fields[3];
+        part.name.assign(cursor, fields[4]);
+        cursor += fields[4];
+        mesh->getSubMeshes().push_back(std::move(part));
+    }
+
+    std::cout << "Loaded from cache: " << mesh->vertexCount() << " vertices, "
+        << mesh->triangleCount() << " triangles" << std::endl;
+
+    return mesh;
+}
+
+bool MeshCache::save(const Mesh& mesh, const std::string& sourcePath, const STLLoadOptions& options) {
+    //The cache holds float storage only, quantize after saving
+    if (mesh.isQuantized())
+        return false;
+
+    Header header{};
+    if (!makeKey(sourcePath, options, header))
+        return false;
+
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+
+    //The views only read through the pointers, the mesh isn't modified
+    std::vector<int> noAdjacency;
+    std::vector<int>& adjacency = mesh.hasTopology()
+        ? const_cast<std::vector<int>&>(mesh.getTopology()->getAdjacency()) : noAdjacency;
+    std::vector<ArrayView> arrays = meshArrays(const_cast<Mesh&>(mesh), adjacency);
+    uint64_t offset = sizeof(Header);
+    for (size_t i = 0; i < SECTION_COUNT; ++i) {
+        header.sections[i].offset = alignUp(offset, DATA_ALIGNMENT);
+        header.sections[i].count = arrays[i].count;
+        offset = header.sections[i].offset + arrays[i].count * arrays[i].elementSize;
+    }
+    header.subMeshCount = mesh.subMeshCount();
+    header.subMeshOffset = offset;
+
+    //Write to a temporary file first so a crash never leaves a half-written cache behind
+    std::string cachePath = cachePathFor(sourcePath);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "Can't write mesh cache: " << cachePath << std::endl;
+            return false;
+        }
+
+        const char padding[DATA_ALIGNMENT] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t written = sizeof(header);
+        for (size_t i = 0; i < SECTION_COUNT; ++i) {
+            file.write(padding, header.sections[i].offset - written);
+            file.write(arrays[i].data, arrays[i].count * arrays[i].elementSize);
+            written = header.sections[i].offset + arrays[i].count * arrays[i].elementSize;
+        }
+        for (const SubMesh& part : mesh.getSubMeshes()) {
+            uint64_t fields[5] = { part.firstVertex, part.vertexCount, part.firstTriangle, part.triangleCount, part.name.size() };
+            file.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+            file.write(part.name.data(), part.name.size());
+        }
+        if (!file) {
+            std::cout << "Can't write mesh cache: " << cachePath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
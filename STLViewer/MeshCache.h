@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "Mesh.h"
+#include "STLLoader.h"
+
+//Binary cache of a preprocessed mesh (welded positions, normals, indices, face attributes, adjacency, parts),
+//stored next to the source file so reopening it skips parsing and preprocessing
+class MeshCache {
+public:
+    //Path of the cache file that belongs to a source file
+    static std::string cachePathFor(const std::string& sourcePath);
+
+    //Returns nullptr if there is no valid cache for the current version of the source file
+    //loaded with these options
+    static std::shared_ptr<Mesh> load(const std::string& sourcePath, const STLLoadOptions& options);
+
+    //Stores the mesh as-is, keyed by the source file's path, size and modification time and by
+    //the options that shaped the result (welding, normals, sampling, snapping, region)
+    static bool save(const Mesh& mesh, const std::string& sourcePath, const STLLoadOptions& options);
+
+private:
+    static constexpr uint32_t CACHE_VERSION = 4;
+    static constexpr size_t DATA_ALIGNMENT = 64;
+
+    //One per mesh array, in the order positions, normals, indices, face normals, adjacency.
+    //Optional arrays that the mesh doesn't have (including the topology) are stored with count 0
+    static constexpr size_t SECTION_COUNT = 5;
+    struct Section {
+        uint64_t offset;
+        uint64_t count; //Elements, not bytes
+    };
+
+    //Everything is little-endian, arrays start at DATA_ALIGNMENT boundaries
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint64_t sourcePathHash;
+        uint64_t optionsHash;
+        Section sections[SECTION_COUNT];
+        uint64_t subMeshCount;
+        uint64_t subMeshOffset; //Per part: first/count of vertices and triangles, name length, name bytes
+    };
+
+    static bool makeKey(const std::string& sourcePath, const STLLoadOptions& options, Header& header);
+};
@@ -6,160 +6,412 @@ void MeshOperations::printMeshDebugInfo(const Mesh& inMesh) {
     std::cout << "Total vertices: " << inMesh.vertexCount() << "\n";
     std::cout << "Total triangles: " << inMesh.triangleCount() << "\n";
 
-    const auto& vertices = inMesh.getVertices();
-    const auto& triangles = inMesh.getTriangles();
+    // Print parts, if any
+    for (const SubMesh& part : inMesh.getSubMeshes()) {
+        std::cout << "Part \"" << part.name << "\": "
+            << part.vertexCount << " vertices from " << part.firstVertex << ", "
+            << part.triangleCount << " triangles from " << part.firstTriangle << "\n";
+    }
+
+    const PositionView positions = inMesh.positionView();
 
     // Print first few vertices
-    for (size_t i = 0; i < std::min<size_t>(5, vertices.size()); ++i) {
-        const auto& v = vertices[i];
+    for (size_t i = 0; i < std::min<size_t>(5, positions.size()); ++i) {
+        glm::vec3 p = positions[i];
+        glm::vec3 n = inMesh.hasNormals() ? inMesh.normalView()[i] : glm::vec3(0.0f);
         std::cout << "Vertex[" << i << "] Pos: ("
-            << v.position.x << ", " << v.position.y << ", " << v.position.z
+            << p.x << ", " << p.y << ", " << p.z
             << ") Normal: ("
-            << v.normal.x << ", " << v.normal.y << ", " << v.normal.z
+            << n.x << ", " << n.y << ", " << n.z
             << ")\n";
     }
 
     // Print first few triangles
-    for (size_t i = 0; i < std::min<size_t>(5, triangles.size()); ++i) {
-        const auto& tri = triangles[i];
+    for (size_t i = 0; i < std::min<size_t>(5, inMesh.triangleCount()); ++i) {
+        const uint32_t* tri = inMesh.triangle(i);
+        glm::vec3 faceNormal = inMesh.hasFaceNormals() ? inMesh.getFaceNormals()[i] : glm::vec3(0.0f);
         std::cout << "Triangle[" << i << "] Indices: "
-            << tri.v1 << ", " << tri.v2 << ", " << tri.v3
+            << tri[0] << ", " << tri[1] << ", " << tri[2]
             << " | FaceNormal: ("
-            << tri.faceNormal.x << ", "
-            << tri.faceNormal.y << ", "
-            << tri.faceNormal.z << ")"
-            << " | Neighbors: "
-            << tri.adjacentTriangles[0] << ", "
-            << tri.adjacentTriangles[1] << ", "
-            << tri.adjacentTriangles[2] << "\n";
+            << faceNormal.x << ", "
+            << faceNormal.y << ", "
+            << faceNormal.z << ")";
+        if (inMesh.hasTopology()) {
+            const int* neighbors = inMesh.getTopology()->neighbors(i);
+            std::cout << " | Neighbors: "
+                << neighbors[0] << ", "
+                << neighbors[1] << ", "
+                << neighbors[2];
+        }
+        std::cout << "\n";
     }
 
     std::cout << "------------------------\n";
 }
 
 void MeshOperations::removeDuplicateVertices(Mesh& inMesh) {
-    const std::vector<Vertex>& oldVertices = inMesh.getVertices();
-    std::vector<Vertex> newVertices;
-    std::unordered_map<glm::vec3, int, Vec3Hash, Vec3Equal> positionToIndex;
-    std::vector<int> remap(oldVertices.size(), -1);
-
-    //Build new list of unique vertices
-    for (size_t i = 0; i < oldVertices.size(); ++i) {
-        const glm::vec3& pos = oldVertices[i].position;
-
-        auto it = positionToIndex.find(pos);
-        if (it == positionToIndex.end()) {
-            int newIndex = static_cast<int>(newVertices.size());
-            newVertices.push_back(oldVertices[i]);
-            positionToIndex[pos] = newIndex;
-            remap[i] = newIndex;
+    if (inMesh.isQuantized())
+        return;
+
+    const std::vector<glm::vec3>& positions = inMesh.getPositions();
+    //Map nodes come from one arena instead of one heap allocation per unique vertex
+    ScratchArena scratch(positions.size() * SCRATCH_BYTES_PER_VERTEX);
+    std::pmr::unordered_map<glm::vec3, uint32_t, Vec3Hash, Vec3Equal> positionToIndex(scratch.resource());
+    std::vector<uint32_t> remap(positions.size());
+    std::vector<uint32_t> kept;
+
+    //Build new list of unique vertices for a range of the old ones
+    auto weldRange = [&](size_t first, size_t count) {
+        positionToIndex.clear();
+        for (size_t i = first; i < first + count; ++i) {
+            const glm::vec3& pos = positions[i];
+
+            auto it = positionToIndex.find(pos);
+            if (it == positionToIndex.end()) {
+                uint32_t newIndex = static_cast<uint32_t>(kept.size());
+                kept.push_back(static_cast<uint32_t>(i));
+                positionToIndex[pos] = newIndex;
+                remap[i] = newIndex;
+            }
+            else {
+                remap[i] = it->second;
+            }
         }
-        else {
-            remap[i] = it->second;
+    };
+
+    //Parts never share vertices, so each part is welded on its own
+    std::vector<SubMesh>& parts = inMesh.getSubMeshes();
+    if (parts.empty()) {
+        weldRange(0, positions.size());
+    }
+    else {
+        for (SubMesh& part : parts) {
+            size_t newFirst = kept.size();
+            weldRange(part.firstVertex, part.vertexCount);
+            part.firstVertex = newFirst;
+            part.vertexCount = kept.size() - newFirst;
         }
     }
 
-    //Remap triangle indices
-    for (auto& tri : inMesh.getTriangles()) {
-        tri.v1 = remap[tri.v1];
-        tri.v2 = remap[tri.v2];
-        tri.v3 = remap[tri.v3];
+    compactVertices(inMesh, kept, remap);
+}
+
+void MeshOperations::compactVertices(Mesh& inMesh, const std::vector<uint32_t>& kept, const std::vector<uint32_t>& remap) {
+    //Every per-vertex array is gathered on its own, touching only that attribute
+    auto gather = [&](auto& values) {
+        if (values.size() != remap.size())
+            return;
+        std::remove_reference_t<decltype(values)> newValues(kept.size());
+        for (size_t i = 0; i < kept.size(); ++i)
+            newValues[i] = values[kept[i]];
+        values = std::move(newValues);
+    };
+    gather(inMesh.getPositions());
+    gather(inMesh.getNormals());
+    gather(inMesh.getLattice().keys);
+    gather(inMesh.getQuantized().positions);
+    gather(inMesh.getQuantized().normals);
+    if (inMesh.isQuantized())
+        inMesh.getQuantized().generation = QuantizedVertices::nextGeneration();
+
+    for (uint32_t& index : inMesh.getIndices())
+        index = remap[index];
+}
+
+void MeshOperations::snapToLattice(Mesh& inMesh, float relativeSpacing) {
+    std::vector<glm::vec3>& positions = inMesh.getPositions();
+    PositionLattice& lattice = inMesh.getLattice();
+    lattice = PositionLattice();
+    if (positions.empty())
+        return;
+
+    glm::vec3 min = positions[0];
+    glm::vec3 max = min;
+    for (const glm::vec3& p : positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
     }
 
-    //Replace vertex list
-    inMesh.getVertices() = std::move(newVertices);
+    //Spacing relative to the largest extent, coarse enough for every cell index to fit its bits
+    float extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+    float spacing = std::max(extent * relativeSpacing, extent / static_cast<float>(PositionLattice::AXIS_CELLS - 2));
+    if (!(spacing > 0.0f))
+        spacing = 1.0f; //All vertices at one point
+    lattice.origin = min;
+    lattice.spacing = spacing;
+    lattice.keys.resize(positions.size());
+
+    const float maxCell = static_cast<float>(PositionLattice::AXIS_CELLS - 1);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        glm::vec3 cell = glm::clamp(glm::round((positions[i] - min) / spacing), glm::vec3(0.0f), glm::vec3(maxCell));
+        uint64_t x = static_cast<uint64_t>(cell.x);
+        uint64_t y = static_cast<uint64_t>(cell.y);
+        uint64_t z = static_cast<uint64_t>(cell.z);
+        lattice.keys[i] = x | (y << PositionLattice::AXIS_BITS) | (z << (2 * PositionLattice::AXIS_BITS));
+
+        //Positions are rebuilt from the cell so equal keys give bit-identical positions
+        positions[i] = min + cell * spacing;
+    }
+}
+
+void MeshOperations::weldLatticeVertices(Mesh& inMesh) {
+    const std::vector<uint64_t>& keys = inMesh.getLattice().keys;
+    if (keys.empty() || keys.size() != inMesh.vertexCount())
+        return;
+
+    std::vector<uint32_t> remap(keys.size());
+    std::vector<uint32_t> kept;
+    std::vector<std::pair<uint64_t, uint32_t>> order;
+
+    //Sorting (key, index) puts equal keys next to each other with the earliest vertex first,
+    //so the result matches a first-come hash weld but without any hashing or tolerance
+    auto weldRange = [&](size_t first, size_t count) {
+        order.clear();
+        for (size_t i = first; i < first + count; ++i)
+            order.emplace_back(keys[i], static_cast<uint32_t>(i));
+        std::sort(order.begin(), order.end());
+
+        for (size_t j = 0; j < order.size(); ++j) {
+            bool runStart = j == 0 || order[j].first != order[j - 1].first;
+            remap[order[j].second] = runStart ? order[j].second : remap[order[j - 1].second];
+        }
+
+        //Keep first occurrences in their original order
+        for (size_t i = first; i < first + count; ++i) {
+            if (remap[i] == i) {
+                remap[i] = static_cast<uint32_t>(kept.size());
+                kept.push_back(static_cast<uint32_t>(i));
+            }
+            else {
+                remap[i] = remap[remap[i]];
+            }
+        }
+    };
+
+    //Parts never share vertices, so each part is welded on its own
+    std::vector<SubMesh>& parts = inMesh.getSubMeshes();
+    if (parts.empty()) {
+        weldRange(0, keys.size());
+    }
+    else {
+        for (SubMesh& part : parts) {
+            size_t newFirst = kept.size();
+            weldRange(part.firstVertex, part.vertexCount);
+            part.firstVertex = newFirst;
+            part.vertexCount = kept.size() - newFirst;
+        }
+    }
+
+    compactVertices(inMesh, kept, remap);
+}
+
+void MeshOperations::computeFaceNormals(Mesh& inMesh) {
+    const PositionView positions = inMesh.positionView();
+    const std::vector<uint32_t>& indices = inMesh.getIndices();
+    std::vector<glm::vec3>& faceNormals = inMesh.getFaceNormals();
+    faceNormals.resize(inMesh.triangleCount());
+
+    //Normal from the winding order, zero for degenerate triangles
+    for (size_t t = 0; t < faceNormals.size(); ++t) {
+        glm::vec3 a = positions[indices[3 * t]];
+        glm::vec3 b = positions[indices[3 * t + 1]];
+        glm::vec3 c = positions[indices[3 * t + 2]];
+
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        faceNormals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
 }
 
 void MeshOperations::computePerVertexNormals(Mesh& inMesh) {
-    std::vector<Vertex>& vertices = inMesh.getVertices();
-    const std::vector<Triangle>& triangles = inMesh.getTriangles();
+    //Face normals are an optional attribute, loaders may have skipped them
+    if (!inMesh.hasFaceNormals())
+        computeFaceNormals(inMesh);
+
+    const std::vector<uint32_t>& indices = inMesh.getIndices();
+    const std::vector<glm::vec3>& faceNormals = inMesh.getFaceNormals();
+    std::vector<glm::vec3>& normals = inMesh.getNormals();
 
     //Resetting to 0.0f
-    for (auto& v : vertices) {
-        v.normal = glm::vec3(0.0f);
-    }
+    normals.assign(inMesh.vertexCount(), glm::vec3(0.0f));
 
     //Accumulate triangle normals
-    for (const auto& tri : triangles) {
-        const glm::vec3& tempfaceNormal = tri.faceNormal;
+    for (size_t t = 0; t < faceNormals.size(); ++t) {
+        const glm::vec3& tempfaceNormal = faceNormals[t];
 
-        vertices[tri.v1].normal += tempfaceNormal;
-        vertices[tri.v2].normal += tempfaceNormal;
-        vertices[tri.v3].normal += tempfaceNormal;
+        normals[indices[3 * t]] += tempfaceNormal;
+        normals[indices[3 * t + 1]] += tempfaceNormal;
+        normals[indices[3 * t + 2]] += tempfaceNormal;
     }
 
     //Normalize
-    for (auto& v : vertices) {
-        if (glm::length(v.normal) > 1e-6f) {
-            v.normal = glm::normalize(v.normal);
+    for (auto& n : normals) {
+        if (glm::length(n) > 1e-6f) {
+            n = glm::normalize(n);
         }
         else {
-            v.normal = glm::vec3(0.0f); 
+            n = glm::vec3(0.0f); 
         }
     }
+
+    //Quantized meshes keep only the encoded normals
+    if (inMesh.isQuantized()) {
+        std::vector<glm::i16vec2>& encoded = inMesh.getQuantized().normals;
+        encoded.resize(normals.size());
+        for (size_t i = 0; i < normals.size(); ++i)
+            encoded[i] = QuantizedVertices::encodeNormal(normals[i]);
+        inMesh.getQuantized().generation = QuantizedVertices::nextGeneration();
+        std::vector<glm::vec3>().swap(normals);
+    }
+}
+
+void MeshOperations::quantizeVertices(Mesh& inMesh) {
+    if (inMesh.isQuantized() || inMesh.vertexCount() == 0)
+        return;
+
+    std::vector<glm::vec3>& positions = inMesh.getPositions();
+    std::vector<glm::vec3>& normals = inMesh.getNormals();
+    QuantizedVertices& quantized = inMesh.getQuantized();
+
+    glm::vec3 min = positions[0];
+    glm::vec3 max = min;
+    for (const glm::vec3& p : positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    quantized.origin = min;
+    quantized.extent = max - min;
+
+    //Flat axes have no extent, every position on them quantizes to 0
+    glm::vec3 toSteps(0.0f);
+    for (int axis = 0; axis < 3; ++axis) {
+        if (quantized.extent[axis] > 0.0f)
+            toSteps[axis] = QuantizedVertices::POSITION_STEPS / quantized.extent[axis];
+    }
+
+    quantized.positions.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        glm::vec3 steps = glm::round((positions[i] - min) * toSteps);
+        quantized.positions[i] = glm::u16vec3(glm::clamp(steps, 0.0f, QuantizedVertices::POSITION_STEPS));
+    }
+
+    if (normals.size() == positions.size()) {
+        quantized.normals.resize(normals.size());
+        for (size_t i = 0; i < normals.size(); ++i)
+            quantized.normals[i] = QuantizedVertices::encodeNormal(normals[i]);
+    }
+    quantized.generation = QuantizedVertices::nextGeneration();
+
+    //Swap instead of clear so the float storage is actually given back
+    std::vector<glm::vec3>().swap(positions);
+    std::vector<glm::vec3>().swap(normals);
+}
+
+void MeshOperations::dequantizeVertices(Mesh& inMesh) {
+    if (!inMesh.isQuantized())
+        return;
+
+    QuantizedVertices& quantized = inMesh.getQuantized();
+    const PositionView positionView = inMesh.positionView();
+    const NormalView normalView = inMesh.normalView();
+
+    std::vector<glm::vec3> positions(positionView.size());
+    for (size_t i = 0; i < positions.size(); ++i)
+        positions[i] = positionView[i];
+    std::vector<glm::vec3> normals(normalView.size());
+    for (size_t i = 0; i < normals.size(); ++i)
+        normals[i] = normalView[i];
+
+    inMesh.getPositions() = std::move(positions);
+    inMesh.getNormals() = std::move(normals);
+    quantized = QuantizedVertices();
 }
 
 void MeshOperations::computeAdjacency(Mesh& inMesh) {
-    auto& triangles = inMesh.getTriangles();
-    std::unordered_map<Edge, std::vector<int>, EdgeHash> edgeToFaces;
+    const std::vector<uint32_t>& indices = inMesh.getIndices();
+    const int triangleCount = static_cast<int>(inMesh.triangleCount());
+    std::shared_ptr<MeshTopology> topology = std::make_shared<MeshTopology>(inMesh.triangleCount());
+    std::vector<int>& adjacency = topology->getAdjacency();
+    //Nodes and the per-edge face lists (which get the map's allocator) all come from one arena
+    ScratchArena scratch(indices.size() * SCRATCH_BYTES_PER_EDGE);
+    std::pmr::unordered_map<Edge, std::pmr::vector<int>, EdgeHash> edgeToFaces(scratch.resource());
+    edgeToFaces.reserve(indices.size() / 2);
+
+    auto edgeOf = [&](int t, int e) {
+        return Edge(static_cast<int>(indices[3 * t + e]), static_cast<int>(indices[3 * t + (e + 1) % 3]));
+    };
 
     //Build edge-to-triangle map
-    for (int i = 0; i < static_cast<int>(triangles.size()); ++i) {
-        const Triangle& tri = triangles[i];
-        edgeToFaces[Edge(tri.v1, tri.v2)].push_back(i);
-        edgeToFaces[Edge(tri.v2, tri.v3)].push_back(i);
-        edgeToFaces[Edge(tri.v3, tri.v1)].push_back(i);
+    for (int i = 0; i < triangleCount; ++i) {
+        for (int e = 0; e < 3; ++e) {
+            std::pmr::vector<int>& faces = edgeToFaces[edgeOf(i, e)];
+            if (faces.empty())
+                faces.reserve(2); //Most edges are shared by exactly two triangles
+            faces.push_back(i);
+        }
     }
 
     //Assign adjacent triangle indices
-    for (int i = 0; i < static_cast<int>(triangles.size()); ++i) {
-        Triangle& tri = triangles[i];
-        std::array<Edge, 3> edges = {
-            Edge(tri.v1, tri.v2),
-            Edge(tri.v2, tri.v3),
-            Edge(tri.v3, tri.v1)
-        };
-
+    for (int i = 0; i < triangleCount; ++i) {
         for (int e = 0; e < 3; ++e) {
-            const auto& faceList = edgeToFaces[edges[e]];
+            const auto& faceList = edgeToFaces[edgeOf(i, e)];
 
             for (int neighbor : faceList) {
                 if (neighbor != i) {
-                    tri.adjacentTriangles[e] = neighbor;
+                    adjacency[3 * i + e] = neighbor;
                     break; //Only one adjacent triangle per edge
                 }
             }
         }
     }
+
+    inMesh.setTopology(std::move(topology));
+}
+
+const MeshTopology& MeshOperations::getTopology(Mesh& inMesh) {
+    if (!inMesh.hasTopology())
+        computeAdjacency(inMesh);
+    return *inMesh.getTopology();
+}
+
+void MeshOperations::printScratchStats() {
+    ScratchStats stats = ScratchArena::totals();
+    std::cout << "Scratch memory: " << stats.requests << " allocations served by "
+        << stats.systemAllocations << " heap allocations (" << (stats.systemBytes >> 20) << " MB)\n";
 }
 
 void MeshOperations::printNeighborCounts(const Mesh& inMesh) {
-    const auto& triangles = inMesh.getTriangles();
+    std::vector<int> counts = getNeighborCounts(inMesh);
 
-    for (size_t i = 0; i < triangles.size(); ++i) {
-        int count = 0;
-        for (int j = 0; j < 3; ++j) {
-            if (triangles[i].adjacentTriangles[j] != -1) {
-                ++count;
-            }
-        }
-        std::cout << "Triangle " << i << " has " << count << " neighbor(s).\n";
+    for (size_t i = 0; i < counts.size(); ++i) {
+        std::cout << "Triangle " << i << " has " << counts[i] << " neighbor(s).\n";
+    }
+}
+
+void MeshOperations::printNeighborHistogram(const Mesh& inMesh) {
+    size_t histogram[4] = {};
+    for (int count : getNeighborCounts(inMesh))
+        ++histogram[count];
+
+    for (int i = 0; i < 4; ++i) {
+        std::cout << "Triangles with " << i << " neighbor(s): " << histogram[i] << "\n";
     }
 }
 
 std::vector<int> MeshOperations::getNeighborCounts(const Mesh& inMesh) {
-    std::vector<int> counts;
-    counts.reserve(inMesh.triangleCount());
+    std::vector<int> counts(inMesh.triangleCount(), 0);
+    if (!inMesh.hasTopology())
+        return counts;
 
-    const auto& triangles = inMesh.getTriangles();
-    for (const Triangle& tri : triangles) {
+    const std::vector<int>& adjacency = inMesh.getTopology()->getAdjacency();
+    for (size_t t = 0; t < counts.size(); ++t) {
         int count = 0;
         for (int i = 0; i < 3; ++i) {
-            if (tri.adjacentTriangles[i] != -1) {
+            if (adjacency[3 * t + i] != MeshTopology::NO_NEIGHBOR) {
                 ++count;
             }
         }
-        counts.push_back(count);
+        counts[t] = count;
     }
 
     return counts;
@@ -1,22 +1,51 @@
 #pragma once
 #include <unordered_map>
+#include <memory_resource>
 #include <vector>
 #include <cmath>
 #include <array>
 #include <iostream>
 #include "Mesh.h"
+#include "ScratchMemory.h"
 
 
 class MeshOperations {
 public:
-    //Removes duplicate vertices in the mesh and updates triangle indices
+    //Removes duplicate vertices in the mesh and updates triangle indices. Does nothing on quantized meshes
     static void removeDuplicateVertices         (Mesh& inMesh);
+    //Snaps positions to an integer lattice spaced relativeSpacing times the largest bounding box extent
+    //(never finer than 2^21 cells per axis) and stores the 64-bit key of every vertex
+    static void snapToLattice                   (Mesh& inMesh, float relativeSpacing);
+    //Exact, deterministic weld on the lattice keys (sorted, not compared with an epsilon).
+    //Does nothing unless the mesh has been snapped
+    static void weldLatticeVertices             (Mesh& inMesh);
+    static void computeFaceNormals              (Mesh& inMesh);
+    //Replaces the float positions and normals by 16-bit positions over the bounding box and
+    //octahedral normals (24 bytes per vertex down to 10). Positions move by about half a step (extent / 131070) per axis
+    static void quantizeVertices                (Mesh& inMesh);
+    //Back to float storage, e.g. before welding or snapping a quantized mesh
+    static void dequantizeVertices              (Mesh& inMesh);
     static void computePerVertexNormals         (Mesh& inMesh);
+    //Builds the topology side table and attaches it to the mesh, replacing an older one
     static void computeAdjacency                (Mesh& inMesh);
+    //The mesh's topology, built on first use
+    static const MeshTopology& getTopology      (Mesh& inMesh);
+    //All zeros if the mesh has no topology yet
     static void printNeighborCounts             (const Mesh& inMesh);
+    //One line per neighbour count (0 to 3) with the number of triangles that have it
+    static void printNeighborHistogram          (const Mesh& inMesh);
     static std::vector<int> getNeighborCounts   (const Mesh& inMesh);
     static void printMeshDebugInfo              (const Mesh& inMesh);
+    //Allocations made by the temporary containers of all passes so far, see ScratchArena
+    static void printScratchStats               ();
 private:
+    //First arena block sizes, rough upper bounds of the hash map memory per input element
+    static constexpr size_t SCRATCH_BYTES_PER_VERTEX = 32;
+    static constexpr size_t SCRATCH_BYTES_PER_EDGE = 48;
+
+    //Keeps the vertices listed in kept (in that order) and renumbers the indices through remap
+    static void compactVertices(Mesh& inMesh, const std::vector<uint32_t>& kept, const std::vector<uint32_t>& remap);
+
     //Helper to hash glm::vec3 (position)
     struct Vec3Hash {
         size_t operator()(const glm::vec3& v) const {
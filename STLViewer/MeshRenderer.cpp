@@ -2,6 +2,7 @@
 #include <vector>
 #include <iostream>
 #include "MeshOperations.h"
+#include "STLLoader.h"
 
 MeshRenderer::MeshRenderer()
     : VAO(0), VBO(0), EBO(0), buffersCreated(false) {
@@ -21,6 +22,19 @@ void MeshRenderer::createBuffers() {
 }
 
 void MeshRenderer::deleteBuffers() {
+    if (quantizedVAO) {
+        glDeleteVertexArrays(1, &quantizedVAO);
+        glDeleteBuffers(2, quantizedBuffers);
+        quantizedVAO = 0;
+        quantizedGeneration = 0;
+    }
+
+    if (uploadedVAO) {
+        glDeleteVertexArrays(1, &uploadedVAO);
+        glDeleteBuffers(1, &uploadedVBO);
+        uploadedVAO = uploadedVBO = 0;
+    }
+
     if (!buffersCreated) return;
 
     glDeleteVertexArrays(1, &VAO);
@@ -33,10 +47,16 @@ void MeshRenderer::renderMesh(Mesh& mesh) {
     if (mesh.triangleCount() == 0 || mesh.vertexCount() == 0)
         return;
 
+    if (mesh.isQuantized()) {
+        renderQuantized(mesh);
+        return;
+    }
+
     createBuffers();
+    setPositionDecode(glm::vec3(0.0f), glm::vec3(1.0f));
 
     // Compute adjacency if not already done
-    MeshOperations::computeAdjacency(mesh);
+    MeshOperations::getTopology(mesh);
     std::vector<int> neighborCounts = MeshOperations::getNeighborCounts(mesh);
 
     // Generate colored vertex data
@@ -48,11 +68,11 @@ void MeshRenderer::renderMesh(Mesh& mesh) {
     std::vector<VertexData> vertexData;
     std::vector<unsigned int> indices;
 
-    const auto& triangles = mesh.getTriangles();
-    const auto& vertices = mesh.getVertices();
+    const auto& positions = mesh.getPositions();
+    const size_t triangleCount = mesh.triangleCount();
 
-    for (size_t i = 0; i < triangles.size(); ++i) {
-        const Triangle& tri = triangles[i];
+    for (size_t i = 0; i < triangleCount; ++i) {
+        const uint32_t* tri = mesh.triangle(i);
         glm::vec3 color;
 
         switch (neighborCounts[i]) {
@@ -65,9 +85,9 @@ void MeshRenderer::renderMesh(Mesh& mesh) {
 
         unsigned int baseIndex = static_cast<unsigned int>(vertexData.size());
 
-        vertexData.push_back({ vertices[tri.v1].position, color });
-        vertexData.push_back({ vertices[tri.v2].position, color });
-        vertexData.push_back({ vertices[tri.v3].position, color });
+        vertexData.push_back({ positions[tri[0]], color });
+        vertexData.push_back({ positions[tri[1]], color });
+        vertexData.push_back({ positions[tri[2]], color });
 
         indices.push_back(baseIndex);
         indices.push_back(baseIndex + 1);
@@ -104,9 +124,9 @@ void MeshRenderer::setNeighborData(const Mesh& mesh, const std::vector<int>& nei
 
     // Expand triangle-based neighbor data to vertex-level (duplicated per triangle)
     std::vector<float> expandedNeighborData;
-    const auto& triangles = mesh.getTriangles();
+    const size_t triangleCount = mesh.triangleCount();
 
-    for (size_t i = 0; i < triangles.size(); ++i) {
+    for (size_t i = 0; i < triangleCount; ++i) {
         float value = static_cast<float>(neighborCounts[i]);
         // Push one value per triangle vertex (3 vertices)
         expandedNeighborData.push_back(value);
@@ -127,12 +147,17 @@ void MeshRenderer::setNeighborData(const Mesh& mesh, const std::vector<int>& nei
 }
 
 void MeshRenderer::renderNormals(const Mesh& mesh, float scale) {
-    const auto& vertices = mesh.getVertices();
+    if (!mesh.hasNormals())
+        return;
+
+    const PositionView positions = mesh.positionView();
+    const NormalView normals = mesh.normalView();
+    setPositionDecode(glm::vec3(0.0f), glm::vec3(1.0f));
 
     std::vector<glm::vec3> lineVertices;
-    for (const auto& v : vertices) {
-        lineVertices.push_back(v.position);                          // start point
-        lineVertices.push_back(v.position + scale * v.normal);       // end point
+    for (size_t i = 0; i < positions.size(); ++i) {
+        lineVertices.push_back(positions[i]);                        // start point
+        lineVertices.push_back(positions[i] + scale * normals[i]);   // end point
     }
 
     GLuint normalVBO, normalVAO;
@@ -153,3 +178,97 @@ void MeshRenderer::renderNormals(const Mesh& mesh, float scale) {
     glDeleteBuffers(1, &normalVBO);
     glDeleteVertexArrays(1, &normalVAO);
 }
+
+bool MeshRenderer::uploadBinarySTL(const std::string& filename) {
+    if (!uploadedVAO) {
+        glGenVertexArrays(1, &uploadedVAO);
+        glGenBuffers(1, &uploadedVBO);
+    }
+
+    glBindVertexArray(uploadedVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, uploadedVBO);
+
+    // The buffer is sized once the facet count is known, then mapped write-only for the decoder
+    bool mapped = false;
+    size_t facets = STLLoader::decodeBinaryPositions(filename, [&](size_t facetCount) -> char* {
+        GLsizeiptr bytes = static_cast<GLsizeiptr>(facetCount * 3 * sizeof(glm::vec3));
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+        void* destination = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        mapped = destination != nullptr;
+        return static_cast<char*>(destination);
+    }, sizeof(glm::vec3));
+
+    // The driver may drop the contents (e.g. on a display mode change), the data is gone then
+    bool valid = mapped && glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE && facets > 0;
+    uploadedTriangles = valid ? facets : 0;
+
+    if (valid) {
+        // Position only, the color attribute is left disabled and set as a constant when drawing
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        glEnableVertexAttribArray(0);
+    }
+
+    glBindVertexArray(0);
+    return valid;
+}
+
+void MeshRenderer::renderUploaded() {
+    if (uploadedTriangles == 0)
+        return;
+
+    setPositionDecode(glm::vec3(0.0f), glm::vec3(1.0f));
+    glBindVertexArray(uploadedVAO);
+    glVertexAttrib3f(1, 1.0f, 1.0f, 1.0f);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(uploadedTriangles * 3));
+    glBindVertexArray(0);
+}
+
+void MeshRenderer::renderQuantized(const Mesh& mesh) {
+    if (!mesh.isQuantized() || mesh.triangleCount() == 0)
+        return;
+
+    if (quantizedGeneration != mesh.getQuantized().generation || quantizedTriangles != mesh.triangleCount())
+        uploadQuantized(mesh);
+
+    const QuantizedVertices& quantized = mesh.getQuantized();
+    setPositionDecode(quantized.origin, quantized.extent / QuantizedVertices::POSITION_STEPS);
+
+    glBindVertexArray(quantizedVAO);
+    glVertexAttrib3f(1, 1.0f, 1.0f, 1.0f);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(quantizedTriangles * 3), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+void MeshRenderer::uploadQuantized(const Mesh& mesh) {
+    const QuantizedVertices& quantized = mesh.getQuantized();
+
+    if (!quantizedVAO) {
+        glGenVertexArrays(1, &quantizedVAO);
+        glGenBuffers(2, quantizedBuffers);
+    }
+    glBindVertexArray(quantizedVAO);
+
+    // Integer attributes are passed unnormalized and scaled in the shader, the
+    // normalization rules for signed values differ between GL versions
+    glBindBuffer(GL_ARRAY_BUFFER, quantizedBuffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, quantized.positions.size() * sizeof(glm::u16vec3), quantized.positions.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(glm::u16vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quantizedBuffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.getIndices().size() * sizeof(uint32_t), mesh.getIndices().data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    quantizedGeneration = quantized.generation;
+    quantizedTriangles = mesh.triangleCount();
+}
+
+void MeshRenderer::setPositionDecode(const glm::vec3& origin, const glm::vec3& scale) {
+    GLint program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    if (program == 0)
+        return;
+
+    glUniform3f(glGetUniformLocation(program, "positionOrigin"), origin.x, origin.y, origin.z);
+    glUniform3f(glGetUniformLocation(program, "positionScale"), scale.x, scale.y, scale.z);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <glad/glad.h>
 #include "Mesh.h" // Your mesh header
+#include <string>
 
 class MeshRenderer {
 public:
@@ -11,11 +12,29 @@ public:
     void setNeighborData(const Mesh& mesh, const std::vector<int>& neighborCounts);
     void renderNormals(const Mesh& mesh, float scale = 0.1f);
 
+    // Quantized meshes (see MeshOperations::quantizeVertices) upload their 16-bit positions once,
+    // shared by index, and the vertex shader decodes them. Nothing is shaded, so normals stay on the CPU. renderMesh forwards them here
+    void renderQuantized(const Mesh& mesh);
+
+    // View-only path for binary STL files: corners are decoded from the file straight into a mapped
+    // vertex buffer, with no Mesh or vertexData copy in between. Returns false for other formats
+    bool uploadBinarySTL(const std::string& filename);
+    void renderUploaded();
+    size_t uploadedTriangleCount() const { return uploadedTriangles; }
+
 private:
     unsigned int VAO, VBO, EBO;
     bool buffersCreated;
     unsigned int neighborVBO = 0;
+    unsigned int uploadedVAO = 0, uploadedVBO = 0;
+    size_t uploadedTriangles = 0;
+    unsigned int quantizedVAO = 0, quantizedBuffers[2] = {}; // positions, indices
+    uint64_t quantizedGeneration = 0; // QuantizedVertices::generation of the uploaded data
+    size_t quantizedTriangles = 0;
 
     void createBuffers();
     void deleteBuffers();
+    void uploadQuantized(const Mesh& mesh);
+    // Sets the vertex shader's position decode (origin + scale * attribute) on the current program
+    void setPositionDecode(const glm::vec3& origin, const glm::vec3& scale);
 };
\ No newline at end of file
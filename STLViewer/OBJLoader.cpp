@@ -0,0 +1,76 @@
+#include "OBJLoader.h"
+#include "MappedFile.h"
+#include "MeshOperations.h"
+#include "TextScanner.h"
+#include <cstdint>
+#include <vector>
+
+std::shared_ptr<Mesh> OBJLoader::load(const std::string& filename) {
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        std::cout << "Can't open file!" << std::endl;
+        return mesh;
+    }
+
+    TextScanner scanner{ file.data(), file.data() + file.size() };
+    std::vector<int> polygon;
+    size_t skippedFaces = 0;
+
+    while (true) {
+        scanner.skipSpace();
+        if (scanner.atEnd())
+            break;
+
+        const char* lineStart = scanner.p;
+        std::string_view keyword = scanner.nextWord();
+
+        if (keyword == "v") {
+            mesh->addVertex(scanner.nextVec3());
+        }
+        else if (keyword == "f") {
+            //Corners are "v", "v/vt", "v//vn" or "v/vt/vn"; negative indices count back from the last vertex
+            polygon.clear();
+            bool valid = true;
+            while (!scanner.atLineEnd()) {
+                int64_t index = 0;
+                if (!scanner.parseInt(index)) {
+                    valid = false;
+                    scanner.skipLine();
+                    break;
+                }
+                while (!scanner.atEnd() && !isTextSpace(*scanner.p))
+                    ++scanner.p;
+
+                int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(mesh->vertexCount()) + index;
+                if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(mesh->vertexCount()))
+                    valid = false;
+                polygon.push_back(static_cast<int>(resolved));
+            }
+
+            if (!valid || polygon.size() < 3) {
+                ++skippedFaces;
+            }
+            else {
+                for (size_t i = 1; i + 1 < polygon.size(); ++i)
+                    mesh->addTriangle(polygon[0], polygon[i], polygon[i + 1]);
+            }
+        }
+
+        //Everything else (vt, vn, o, g, usemtl, comments...) is ignored
+        if (scanner.p == lineStart)
+            ++scanner.p;
+        scanner.skipLine();
+    }
+
+    if (skippedFaces > 0)
+        std::cout << "Skipped " << skippedFaces << " faces with invalid indices" << std::endl;
+
+    MeshOperations::computeFaceNormals(*mesh);
+
+    std::cout << "Loaded: " << mesh->vertexCount() << " vertices, "
+        << mesh->triangleCount() << " triangles" << std::endl;
+
+    return mesh;
+}
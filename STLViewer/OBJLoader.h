@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <iostream>
+#include "Mesh.h"
+
+//Wavefront OBJ importer for geometry ("v" and "f" records). OBJ files are already indexed,
+//so the result needs no welding; polygons are fan-triangulated and texture/normal indices ignored
+class OBJLoader {
+public:
+    static std::shared_ptr<Mesh> load(const std::string& filename);
+};
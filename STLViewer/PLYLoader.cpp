@@ -0,0 +1,350 @@
+#include "PLYLoader.h"
+#include "MappedFile.h"
+#include "MeshOperations.h"
+#include "TextScanner.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+
+namespace {
+    bool isFaceIndexList(const std::string& name) {
+        return name == "vertex_indices" || name == "vertex_index";
+    }
+
+    //Turns one polygon into a triangle fan, dropping faces with invalid indices
+    void addPolygon(Mesh& mesh, const std::vector<int64_t>& polygon, size_t vertexCount) {
+        if (polygon.size() < 3)
+            return;
+        for (int64_t index : polygon) {
+            if (index < 0 || static_cast<size_t>(index) >= vertexCount)
+                return;
+        }
+        for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+            mesh.addTriangle(static_cast<uint32_t>(polygon[0]), static_cast<uint32_t>(polygon[i]),
+                static_cast<uint32_t>(polygon[i + 1]));
+        }
+    }
+}
+
+std::shared_ptr<Mesh> PLYLoader::load(const std::string& filename) {
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        std::cout << "Can't open file!" << std::endl;
+        return mesh;
+    }
+
+    const char* data = file.data();
+    const char* end = data + file.size();
+
+    //The header is plain text up to and including the "end_header" line
+    const std::string_view endHeader = "end_header";
+    const char* headerEnd = std::search(data, end, endHeader.begin(), endHeader.end());
+    if (file.size() < 3 || std::strncmp(data, "ply", 3) != 0 || headerEnd == end) {
+        std::cout << "Not a PLY file: " << filename << std::endl;
+        return mesh;
+    }
+
+    const char* body = headerEnd + endHeader.size();
+    while (body < end && *body != '\n')
+        ++body;
+    if (body < end)
+        ++body;
+
+    std::istringstream header(std::string(data, headerEnd));
+    std::vector<Element> elements;
+    std::string format;
+    std::string line;
+    while (std::getline(header, line)) {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "format") {
+            words >> format;
+        }
+        else if (keyword == "element") {
+            Element element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        }
+        else if (keyword == "property" && !elements.empty()) {
+            Property property;
+            std::string type;
+            words >> type;
+            if (type == "list") {
+                std::string countType, itemType;
+                words >> countType >> itemType;
+                property.isList = true;
+                property.countType = parseType(countType);
+                property.type = parseType(itemType);
+            }
+            else {
+                property.type = parseType(type);
+            }
+            words >> property.name;
+
+            if (property.type == PropertyType::Invalid || (property.isList && property.countType == PropertyType::Invalid)) {
+                std::cout << "Unsupported PLY property type in: " << line << std::endl;
+                return mesh;
+            }
+            elements.back().properties.push_back(property);
+        }
+    }
+
+    bool ok = false;
+    if (format == "binary_little_endian") {
+        ok = loadBinary(body, end, elements, *mesh);
+    }
+    else if (format == "ascii") {
+        ok = loadAscii(body, end, elements, *mesh);
+    }
+    else {
+        std::cout << "Unsupported PLY format: " << format << std::endl;
+        return mesh;
+    }
+
+    if (!ok)
+        std::cout << "PLY file is truncated or malformed: " << filename << std::endl;
+
+    MeshOperations::computeFaceNormals(*mesh);
+
+    std::cout << "Loaded: " << mesh->vertexCount() << " vertices, "
+        << mesh->triangleCount() << " triangles" << std::endl;
+
+    return mesh;
+}
+
+PLYLoader::PropertyType PLYLoader::parseType(const std::string& name) {
+    if (name == "char" || name == "int8") return PropertyType::Int8;
+    if (name == "uchar" || name == "uint8") return PropertyType::UInt8;
+    if (name == "short" || name == "int16") return PropertyType::Int16;
+    if (name == "ushort" || name == "uint16") return PropertyType::UInt16;
+    if (name == "int" || name == "int32") return PropertyType::Int32;
+    if (name == "uint" || name == "uint32") return PropertyType::UInt32;
+    if (name == "float" || name == "float32") return PropertyType::Float32;
+    if (name == "double" || name == "float64") return PropertyType::Float64;
+    return PropertyType::Invalid;
+}
+
+size_t PLYLoader::typeSize(PropertyType type) {
+    switch (type) {
+    case PropertyType::Int8:
+    case PropertyType::UInt8: return 1;
+    case PropertyType::Int16:
+    case PropertyType::UInt16: return 2;
+    case PropertyType::Int32:
+    case PropertyType::UInt32:
+    case PropertyType::Float32: return 4;
+    case PropertyType::Float64: return 8;
+    default: return 0;
+    }
+}
+
+double PLYLoader::readBinary(const char* p, PropertyType type) {
+    switch (type) {
+    case PropertyType::Int8: { int8_t v; std::memcpy(&v, p, 1); return v; }
+    case PropertyType::UInt8: { uint8_t v; std::memcpy(&v, p, 1); return v; }
+    case PropertyType::Int16: { int16_t v; std::memcpy(&v, p, 2); return v; }
+    case PropertyType::UInt16: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+    case PropertyType::Int32: { int32_t v; std::memcpy(&v, p, 4); return v; }
+    case PropertyType::UInt32: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+    case PropertyType::Float32: { float v; std::memcpy(&v, p, 4); return v; }
+    case PropertyType::Float64: { double v; std::memcpy(&v, p, 8); return v; }
+    default: return 0.0;
+    }
+}
+
+bool PLYLoader::fixedStride(const Element& element, size_t& stride) {
+    stride = 0;
+    for (const Property& property : element.properties) {
+        if (property.isList)
+            return false;
+        stride += typeSize(property.type);
+    }
+    return true;
+}
+
+size_t PLYLoader::minRecordSize(const Element& element, bool ascii) {
+    //ASCII values are at least one character each, binary lists at least their count
+    size_t size = 0;
+    for (const Property& property : element.properties)
+        size += ascii ? 1 : typeSize(property.isList ? property.countType : property.type);
+    return std::max<size_t>(1, size);
+}
+
+bool PLYLoader::fitsInData(const Element& element, const char* p, const char* end, bool ascii) {
+    return p <= end && element.count <= static_cast<size_t>(end - p) / minRecordSize(element, ascii);
+}
+
+bool PLYLoader::loadBinary(const char* data, const char* end, const std::vector<Element>& elements, Mesh& mesh) {
+    const char* p = data;
+
+    for (const Element& element : elements) {
+        if (!fitsInData(element, p, end, false))
+            return false;
+
+        size_t stride;
+        bool isFixed = fixedStride(element, stride);
+
+        if (element.name == "vertex" && isFixed) {
+            //Fixed-size records: locate x/y/z once, then decode with a constant stride
+            size_t offsets[3] = { 0, 0, 0 };
+            PropertyType types[3] = { PropertyType::Invalid, PropertyType::Invalid, PropertyType::Invalid };
+            size_t offset = 0;
+            for (const Property& property : element.properties) {
+                int axis = property.name == "x" ? 0 : property.name == "y" ? 1 : property.name == "z" ? 2 : -1;
+                if (axis >= 0) {
+                    offsets[axis] = offset;
+                    types[axis] = property.type;
+                }
+                offset += typeSize(property.type);
+            }
+
+            if (stride > 0 && element.count > static_cast<size_t>(end - p) / stride)
+                return false;
+
+            std::vector<glm::vec3>& positions = mesh.getPositions();
+            positions.resize(element.count);
+
+            bool packedFloats = types[0] == PropertyType::Float32 && types[1] == PropertyType::Float32 &&
+                types[2] == PropertyType::Float32 && offsets[1] == offsets[0] + 4 && offsets[2] == offsets[0] + 8;
+            for (size_t i = 0; i < element.count; ++i, p += stride) {
+                if (packedFloats) {
+                    std::memcpy(&positions[i], p + offsets[0], sizeof(glm::vec3));
+                }
+                else {
+                    for (int axis = 0; axis < 3; ++axis) {
+                        if (types[axis] != PropertyType::Invalid)
+                            positions[i][axis] = static_cast<float>(readBinary(p + offsets[axis], types[axis]));
+                    }
+                }
+            }
+        }
+        else if (element.name == "face") {
+            mesh.getIndices().reserve(mesh.getIndices().size() + element.count * 3);
+
+            std::vector<int64_t> polygon;
+            for (size_t i = 0; i < element.count; ++i) {
+                for (const Property& property : element.properties) {
+                    if (!property.isList) {
+                        p += typeSize(property.type);
+                        continue;
+                    }
+
+                    size_t countSize = typeSize(property.countType);
+                    if (p + countSize > end)
+                        return false;
+                    size_t count = static_cast<size_t>(readBinary(p, property.countType));
+                    p += countSize;
+
+                    size_t itemSize = typeSize(property.type);
+                    if (count > static_cast<size_t>(end - p) / itemSize)
+                        return false;
+
+                    if (isFaceIndexList(property.name)) {
+                        polygon.resize(count);
+                        for (size_t k = 0; k < count; ++k)
+                            polygon[k] = static_cast<int64_t>(readBinary(p + k * itemSize, property.type));
+                        addPolygon(mesh, polygon, mesh.vertexCount());
+                    }
+                    p += count * itemSize;
+                }
+                if (p > end)
+                    return false;
+            }
+        }
+        else if (isFixed) {
+            //Unused element, skip it in one step
+            if (stride > 0 && element.count > static_cast<size_t>(end - p) / stride)
+                return false;
+            p += element.count * stride;
+        }
+        else {
+            //Element with lists, every record has to be walked
+            bool isVertex = element.name == "vertex";
+            if (isVertex)
+                mesh.getPositions().reserve(element.count);
+
+            for (size_t i = 0; i < element.count; ++i) {
+                glm::vec3 position(0.0f);
+                for (const Property& property : element.properties) {
+                    if (property.isList) {
+                        if (p + typeSize(property.countType) > end)
+                            return false;
+                        size_t count = static_cast<size_t>(readBinary(p, property.countType));
+                        p += typeSize(property.countType);
+                        if (count > static_cast<size_t>(end - p) / typeSize(property.type))
+                            return false;
+                        p += count * typeSize(property.type);
+                    }
+                    else {
+                        if (p + typeSize(property.type) > end)
+                            return false;
+                        if (isVertex) {
+                            int axis = property.name == "x" ? 0 : property.name == "y" ? 1 : property.name == "z" ? 2 : -1;
+                            if (axis >= 0)
+                                position[axis] = static_cast<float>(readBinary(p, property.type));
+                        }
+                        p += typeSize(property.type);
+                    }
+                }
+                if (p > end)
+                    return false;
+                if (isVertex)
+                    mesh.addVertex(position);
+            }
+        }
+    }
+    return true;
+}
+
+bool PLYLoader::loadAscii(const char* data, const char* end, const std::vector<Element>& elements, Mesh& mesh) {
+    TextScanner scanner{ data, end };
+
+    for (const Element& element : elements) {
+        if (!fitsInData(element, scanner.p, end, true))
+            return false;
+
+        bool isVertex = element.name == "vertex";
+        bool isFace = element.name == "face";
+        if (isVertex)
+            mesh.getPositions().reserve(element.count);
+        if (isFace)
+            mesh.getIndices().reserve(mesh.getIndices().size() + element.count * 3);
+
+        std::vector<int64_t> polygon;
+        for (size_t i = 0; i < element.count; ++i) {
+            if (scanner.atEnd())
+                return false;
+
+            glm::vec3 position(0.0f);
+            for (const Property& property : element.properties) {
+                if (!property.isList) {
+                    float value = scanner.nextFloat();
+                    if (isVertex) {
+                        if (property.name == "x") position.x = value;
+                        else if (property.name == "y") position.y = value;
+                        else if (property.name == "z") position.z = value;
+                    }
+                    continue;
+                }
+
+                size_t count = static_cast<size_t>(std::max<int64_t>(0, scanner.nextInt()));
+                if (count > static_cast<size_t>(end - scanner.p))
+                    return false;
+                polygon.resize(count);
+                for (size_t k = 0; k < count; ++k)
+                    polygon[k] = scanner.nextInt();
+                if (isFace && isFaceIndexList(property.name))
+                    addPolygon(mesh, polygon, mesh.vertexCount());
+            }
+
+            if (isVertex)
+                mesh.addVertex(position);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include "Mesh.h"
+
+//Stanford PLY importer (binary little-endian or ASCII). PLY files are already indexed,
+//so the result needs no welding; polygons are fan-triangulated
+class PLYLoader {
+public:
+    static std::shared_ptr<Mesh> load(const std::string& filename);
+
+private:
+    enum class PropertyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+    struct Property {
+        std::string name;
+        PropertyType type = PropertyType::Invalid;
+        bool isList = false;
+        PropertyType countType = PropertyType::Invalid;
+    };
+
+    struct Element {
+        std::string name;
+        size_t count = 0;
+        std::vector<Property> properties;
+    };
+
+    static PropertyType parseType(const std::string& name);
+    static size_t typeSize(PropertyType type);
+    static double readBinary(const char* p, PropertyType type);
+    static bool fixedStride(const Element& element, size_t& stride);
+    //Fewest bytes one record can take, so header counts can be checked against the data before allocating
+    static size_t minRecordSize(const Element& element, bool ascii);
+    static bool fitsInData(const Element& element, const char* p, const char* end, bool ascii);
+
+    static bool loadBinary(const char* data, const char* end, const std::vector<Element>& elements, Mesh& mesh);
+    static bool loadAscii(const char* data, const char* end, const std::vector<Element>& elements, Mesh& mesh);
+};
@@ -1,48 +1,1081 @@
 #include "STLLoader.h"
+#include "MappedFile.h"
+#include "GzipStream.h"
+#include "BatchFileReader.h"
+#include "TextScanner.h"
+#include "MeshOperations.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
-std::shared_ptr<Mesh> STLLoader::load(const std::string& filename) {
-    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+namespace {
+    //Guesses the facet count of an ASCII range from the size of its first facet.
+    //Exporters write every facet with the same layout, so this is usually within a few percent
+    size_t estimateAsciiFacetCount(const char* begin, const char* end) {
+        const std::string_view facet = "facet normal";
 
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cout << "Can't open file!" << std::endl;
-        return mesh;
+        const char* first = std::search(begin, end, facet.begin(), facet.end());
+        if (first == end)
+            return 0;
+        const char* next = std::search(first + facet.size(), end, facet.begin(), facet.end());
+        if (next == end)
+            return 1;
+
+        //Measure from one facet to the next so the indentation between them is included
+        size_t facetBytes = static_cast<size_t>(next - first);
+        return static_cast<size_t>(end - begin) / facetBytes + 1;
     }
 
-    std::string word;
-    glm::vec3 currentNormal(0.0f);
-    std::vector<int> currentTriIndices;
+    //Text of a binary header up to the first NUL, without surrounding whitespace
+    std::string binaryHeaderName(const char* header) {
+        const char* end = static_cast<const char*>(std::memchr(header, '\0', 80));
+        TextScanner scanner{ header, end ? end : header + 80 };
+        scanner.skipSpace();
+        return std::string(scanner.restOfLine());
+    }
 
-    while (file >> word) {
-        if (word == "facet") {
-            file >> word; 
-            float nx, ny, nz;
-            file >> nx >> ny >> nz;
-            currentNormal = glm::vec3(nx, ny, nz);
+    //Name after the leading "solid" keyword of an ASCII file
+    std::string asciiSolidName(const char* begin, const char* end) {
+        TextScanner scanner{ begin, end };
+        scanner.skipByteOrderMark();
+        if (scanner.nextWord() != "solid")
+            return {};
+        return std::string(scanner.textBefore({ "facet", "endsolid" }));
+    }
+
+    //Accumulates the bounding box and count of the facets it is shown
+    struct BoundsVisitor {
+        glm::vec3 min{ std::numeric_limits<float>::max() };
+        glm::vec3 max{ std::numeric_limits<float>::lowest() };
+        size_t count = 0;
+
+        void operator()(const STLFacet& facet) {
+            for (const glm::vec3& corner : facet.vertices) {
+                min = glm::min(min, corner);
+                max = glm::max(max, corner);
+            }
+            ++count;
         }
-        else if (word == "vertex") {
-            float x, y, z;
-            file >> x >> y >> z;
 
-            Vertex v;
-            v.position = glm::vec3(x, y, z);
-            v.normal = glm::vec3(0, 0, 0);
+        void store(STLFileInfo& info) const {
+            if (count == 0)
+                return;
+            info.boundsMin = min;
+            info.boundsMax = max;
+        }
+    };
 
-            mesh->addVertex(v);
-            currentTriIndices.push_back(mesh->vertexCount() - 1);
+    //Hashes the exact bit pattern of a position, with -0.0 folded into +0.0 to agree with ==
+    struct PositionHash {
+        size_t operator()(const glm::vec3& v) const {
+            uint64_t h = 0x9E3779B97F4A7C15ull;
+            for (int i = 0; i < 3; ++i) {
+                float f = v[i] == 0.0f ? 0.0f : v[i];
+                uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                h = (h ^ bits) * 0xFF51AFD7ED558CCDull;
+                h ^= h >> 32;
+            }
+            return static_cast<size_t>(h);
         }
-        else if (word == "endfacet") {
-            // After reading 3 vertices, store the triangle
-            if (currentTriIndices.size() == 3) {
-                Triangle tri (currentTriIndices[0], currentTriIndices[1], currentTriIndices[2], currentNormal);
-                mesh->addTriangle(tri);
+    };
+
+    //Shares vertices with identical positions while they are being added
+    class VertexWelder {
+    public:
+        explicit VertexWelder(std::vector<glm::vec3>& inPositions) : positions(inPositions) {}
+
+        void reserve(size_t vertexCount) {
+            positions.reserve(positions.size() + vertexCount);
+            positionToIndex.reserve(vertexCount);
+        }
+
+        //Forget previous positions, later vertices won't be shared with earlier ones
+        void clear() {
+            positionToIndex.clear();
+        }
+
+        uint32_t add(const glm::vec3& position) {
+            auto [it, inserted] = positionToIndex.try_emplace(position, static_cast<uint32_t>(positions.size()));
+            if (inserted)
+                positions.push_back(position);
+            return it->second;
+        }
+
+    private:
+        std::vector<glm::vec3>& positions;
+        std::unordered_map<glm::vec3, uint32_t, PositionHash> positionToIndex;
+    };
+
+    //Appends visited facets to a mesh, optionally welding as it goes.
+    //With recordSolids, every "solid" block is recorded as a part and welded on its own.
+    //Face normals are only stored when the normal mode keeps or recomputes them
+    class FacetAppender {
+    public:
+        FacetAppender(Mesh& mesh, const STLLoadOptions& options, bool recordSolids = false)
+            : positions(mesh.getPositions()), indices(mesh.getIndices()), faceNormals(mesh.getFaceNormals()),
+              solids(recordSolids ? &mesh.getSubMeshes() : nullptr), normalMode(options.normals),
+              clip(options.clipToRegion), regionMin(options.regionMin), regionMax(options.regionMax) {
+            if (options.weldVertices)
+                welder = std::make_unique<VertexWelder>(positions);
+        }
+
+        //Pre-sizes storage for the expected number of facets (also called by the compressed-file reader)
+        void reserve(size_t facetCount) {
+            //Storage grows with the facets that pass the region test instead
+            if (clip)
+                return;
+            indices.reserve(indices.size() + facetCount * 3);
+            if (normalMode != STLNormalMode::Skip)
+                faceNormals.reserve(faceNormals.size() + facetCount);
+            if (welder) {
+                //Closed triangle meshes have roughly half as many unique vertices as facets
+                welder->reserve(facetCount / 2 + 3);
+            }
+            else {
+                positions.reserve(positions.size() + facetCount * 3);
+            }
+        }
+
+        void beginSolid(std::string_view name) {
+            if (!solids)
+                return;
+            closeSolid();
+            solids->push_back(SubMesh{ std::string(name), positions.size(), 0, triangleCount(), 0 });
+            if (welder)
+                welder->clear();
+        }
+
+        void operator()(const STLFacet& facet) {
+            if (clip) {
+                glm::vec3 facetMin = glm::min(glm::min(facet.vertices[0], facet.vertices[1]), facet.vertices[2]);
+                glm::vec3 facetMax = glm::max(glm::max(facet.vertices[0], facet.vertices[1]), facet.vertices[2]);
+                if (glm::any(glm::lessThan(facetMax, regionMin)) || glm::any(glm::greaterThan(facetMin, regionMax)))
+                    return;
+            }
+
+            //Facets before any "solid" line continue a part that started earlier (or is unnamed)
+            if (solids && solids->empty()) {
+                solids->push_back(SubMesh{ std::string(), positions.size(), 0, triangleCount(), 0 });
+                continuedSolid = true;
+            }
+
+            for (int c = 0; c < 3; ++c) {
+                if (welder) {
+                    indices.push_back(welder->add(facet.vertices[c]));
+                }
+                else {
+                    indices.push_back(static_cast<uint32_t>(positions.size()));
+                    positions.push_back(facet.vertices[c]);
+                }
+            }
+
+            if (normalMode == STLNormalMode::FromFile) {
+                faceNormals.push_back(facet.normal);
+            }
+            else if (normalMode == STLNormalMode::Recompute) {
+                glm::vec3 normal = glm::cross(facet.vertices[1] - facet.vertices[0], facet.vertices[2] - facet.vertices[0]);
+                float length = glm::length(normal);
+                faceNormals.push_back(length > 0.0f ? normal / length : glm::vec3(0.0f));
             }
-            currentTriIndices.clear();
+        }
+
+        //Fills in the counts of the last part, call once after the last facet
+        void finish() {
+            closeSolid();
+        }
+
+        bool startsWithContinuedSolid() const { return continuedSolid; }
+
+    private:
+        size_t triangleCount() const { return indices.size() / 3; }
+
+        void closeSolid() {
+            if (!solids || solids->empty())
+                return;
+            SubMesh& last = solids->back();
+            last.vertexCount = positions.size() - last.firstVertex;
+            last.triangleCount = triangleCount() - last.firstTriangle;
+        }
+
+        std::vector<glm::vec3>& positions;
+        std::vector<uint32_t>& indices;
+        std::vector<glm::vec3>& faceNormals;
+        std::vector<SubMesh>* solids;
+        std::unique_ptr<VertexWelder> welder;
+        STLNormalMode normalMode;
+        bool clip;
+        glm::vec3 regionMin;
+        glm::vec3 regionMax;
+        bool continuedSolid = false;
+    };
+
+    //Passes every stride-th facet on, with the stride chosen from the facet count announced through reserve
+    template <typename Visitor>
+    struct StrideSampler {
+        Visitor& visitor;
+        size_t targetFacets;
+        size_t stride = 1;
+        size_t index = 0;
+
+        void reserve(size_t facetCount) {
+            stride = std::max<size_t>(1, (facetCount + targetFacets - 1) / targetFacets);
+            visitor.reserve(facetCount / stride + 1);
+        }
+
+        void operator()(const STLFacet& facet) {
+            if (index++ % stride == 0)
+                visitor(facet);
+        }
+    };
+}
+
+bool STLLoader::forEachFacet(const std::string& filename, const std::function<void(const STLFacet&)>& visitor) {
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        std::cout << "Can't open file!" << std::endl;
+        return false;
+    }
+
+    //Facets are decoded one at a time straight from the mapping, so memory use stays constant
+    if (GzipStream::isGzip(file.data(), file.size())) {
+        visitCompressedFacets(file.data(), file.size(), visitor);
+    }
+    else if (isBinary(file.data(), file.size())) {
+        visitBinaryFacets(file.data(), file.size(), visitor);
+    }
+    else {
+        visitAsciiFacets(file.data(), file.data() + file.size(), visitor);
+    }
+    return true;
+}
+
+size_t STLLoader::decodeBinaryPositions(const std::string& filename, const std::function<char*(size_t)>& allocate, size_t stride) {
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        std::cout << "Can't open file!" << std::endl;
+        return 0;
+    }
+    if (GzipStream::isGzip(file.data(), file.size()) || !isBinary(file.data(), file.size()))
+        return 0;
+
+    size_t count = binaryFacetCount(file.data(), file.size());
+    if (count == 0)
+        return 0;
+    char* out = allocate(count);
+    if (!out)
+        return 0;
+
+    //Plain copies, split over threads for big files the same way ASCII chunks are
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, std::max<size_t>(1, count * BINARY_RECORD_SIZE / MIN_ASCII_CHUNK_SIZE));
+
+    auto decodeRange = [&](size_t first, size_t last) {
+        const char* record = file.data() + BINARY_HEADER_SIZE + first * BINARY_RECORD_SIZE;
+        char* corner = out + first * 3 * stride;
+        for (size_t i = first; i < last; ++i, record += BINARY_RECORD_SIZE) {
+            //Skip the normal, the three corners follow it
+            for (int c = 0; c < 3; ++c, corner += stride)
+                std::memcpy(corner, record + (c + 1) * sizeof(glm::vec3), sizeof(glm::vec3));
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threadCount; ++t)
+        workers.emplace_back(decodeRange, count * t / threadCount, count * (t + 1) / threadCount);
+    decodeRange(0, count / threadCount);
+    for (std::thread& worker : workers)
+        worker.join();
+
+    return count;
+}
+
+bool STLLoader::probe(const std::string& filename, STLFileInfo& info) {
+    info = STLFileInfo();
+
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        std::cout << "Can't open file!" << std::endl;
+        return false;
+    }
+    info.fileSize = file.size();
+
+    //Only the pages that are sampled are ever read from disk
+    if (GzipStream::isGzip(file.data(), file.size())) {
+        probeCompressed(file.data(), file.size(), info);
+    }
+    else if (isBinary(file.data(), file.size())) {
+        probeBinary(file.data(), file.size(), info);
+    }
+    else {
+        probeAscii(file.data(), file.size(), info);
+    }
+    return true;
+}
+
+void STLLoader::probeBinary(const char* data, size_t size, STLFileInfo& info) {
+    info.format = STLFormat::Binary;
+    info.name = binaryHeaderName(data);
+    size_t count = binaryFacetCount(data, size);
+    info.triangleCount = count;
+    //A truncated file only holds part of the facets its header declares
+    info.exactCount = BINARY_HEADER_SIZE + uint64_t(declaredBinaryFacetCount(data)) * BINARY_RECORD_SIZE == size;
+
+    //Evenly strided records give a good box for connected meshes
+    size_t stride = std::max<size_t>(1, count / PROBE_BINARY_SAMPLES);
+    BoundsVisitor bounds;
+    STLFacet facet;
+    for (size_t i = 0; i < count; i += stride) {
+        std::memcpy(&facet, data + BINARY_HEADER_SIZE + i * BINARY_RECORD_SIZE, sizeof(facet));
+        bounds(facet);
+    }
+    bounds.store(info);
+    info.exactBounds = stride == 1;
+}
+
+void STLLoader::probeAscii(const char* data, size_t size, STLFileInfo& info) {
+    const char* end = data + size;
+    info.format = STLFormat::Ascii;
+    info.name = asciiSolidName(data, end);
+
+    BoundsVisitor bounds;
+    if (size <= PROBE_WINDOWS * PROBE_WINDOW_SIZE) {
+        visitAsciiFacets(data, end, bounds);
+        bounds.store(info);
+        info.triangleCount = bounds.count;
+        info.exactCount = true;
+        info.exactBounds = true;
+        return;
+    }
+
+    //Parse whole facets inside each window: from just after its first "endfacet"
+    //to the end of its last one, so the byte count holds complete facets only
+    const std::string_view endFacet = "endfacet";
+    size_t sampledBytes = 0;
+    for (size_t w = 0; w < PROBE_WINDOWS; ++w) {
+        const char* from = data + size * w / PROBE_WINDOWS;
+        const char* to = std::min(from + PROBE_WINDOW_SIZE, end);
+        const char* first = std::search(from, to, endFacet.begin(), endFacet.end());
+        if (first == to)
+            continue;
+        const char* begin = first + endFacet.size();
+        const char* last = std::find_end(begin, to, endFacet.begin(), endFacet.end());
+        if (last == to)
+            continue;
+        const char* cut = last + endFacet.size();
+
+        visitAsciiFacets(begin, cut, bounds);
+        sampledBytes += static_cast<size_t>(cut - begin);
+    }
+
+    bounds.store(info);
+    if (sampledBytes > 0)
+        info.triangleCount = static_cast<uint64_t>(static_cast<double>(size) * bounds.count / sampledBytes + 0.5);
+}
+
+void STLLoader::probeCompressed(const char* data, size_t size, STLFileInfo& info) {
+    info.compressed = true;
+
+    GzipStream stream(data, size);
+    if (stream.hasError())
+        return;
+    uint32_t uncompressedSize = GzipStream::uncompressedSizeHint(data, size);
+
+    //Only the start of the stream is decompressed, there is no way to seek into it
+    std::vector<char> window(PROBE_WINDOWS * PROBE_WINDOW_SIZE);
+    size_t filled = 0;
+    bool endOfStream = false;
+    while (!endOfStream && filled < window.size()) {
+        size_t produced = stream.read(window.data() + filled, window.size() - filled);
+        if (produced == 0)
+            endOfStream = true;
+        filled += produced;
+    }
+
+    BoundsVisitor bounds;
+    if (isCompressedBinary(window.data(), filled, uncompressedSize)) {
+        info.format = STLFormat::Binary;
+        info.name = binaryHeaderName(window.data());
+        info.triangleCount = declaredBinaryFacetCount(window.data());
+        //The trailer size agrees with the header unless the file is truncated (or over 4 GB)
+        info.exactCount = BINARY_HEADER_SIZE + info.triangleCount * BINARY_RECORD_SIZE == uncompressedSize;
+
+        size_t count = std::min<size_t>(info.triangleCount, (filled - BINARY_HEADER_SIZE) / BINARY_RECORD_SIZE);
+        STLFacet facet;
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(&facet, window.data() + BINARY_HEADER_SIZE + i * BINARY_RECORD_SIZE, sizeof(facet));
+            bounds(facet);
+        }
+        bounds.store(info);
+        info.exactBounds = count == info.triangleCount;
+        return;
+    }
+
+    info.format = STLFormat::Ascii;
+    info.name = asciiSolidName(window.data(), window.data() + filled);
+    if (endOfStream) {
+        visitAsciiFacets(window.data(), window.data() + filled, bounds);
+        bounds.store(info);
+        info.triangleCount = bounds.count;
+        info.exactCount = true;
+        info.exactBounds = true;
+        return;
+    }
+
+    //Extrapolate from the facets in the window to the size stored in the trailer
+    const std::string_view endFacet = "endfacet";
+    const char* begin = window.data();
+    const char* end = begin + filled;
+    const char* last = std::find_end(begin, end, endFacet.begin(), endFacet.end());
+    if (last == end)
+        return;
+    const char* cut = last + endFacet.size();
+    visitAsciiFacets(begin, cut, bounds);
+    bounds.store(info);
+    info.triangleCount = static_cast<uint64_t>(static_cast<double>(uncompressedSize) * bounds.count / (cut - begin) + 0.5);
+}
+
+std::shared_ptr<Mesh> STLLoader::load(const std::string& filename, const STLLoadOptions& options) {
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        std::cout << "Can't open file!" << std::endl;
+        return std::make_shared<Mesh>();
+    }
+
+    std::shared_ptr<Mesh> mesh = loadFromMemory(file.data(), file.size(), options);
+    if (!mesh)
+        std::cout << "Loading cancelled: " << filename << std::endl;
+    return mesh;
+}
+
+std::vector<std::shared_ptr<Mesh>> STLLoader::loadBatch(const std::vector<std::string>& filenames, const STLLoadOptions& options) {
+    std::vector<std::shared_ptr<Mesh>> meshes(filenames.size());
+
+    STLLoadOptions fileOptions = options;
+    fileOptions.progress = nullptr;
+
+    //Every slot is written by exactly one callback, no locking needed
+    BatchFileReader::readAll(filenames, [&](size_t index, std::vector<char>& contents, bool ok) {
+        if (ok)
+            meshes[index] = loadFromMemory(contents.data(), contents.size(), fileOptions);
+        else
+            std::cout << "Can't read file: " << filenames[index] << std::endl;
+    });
+    return meshes;
+}
+
+std::shared_ptr<Mesh> STLLoader::loadFromMemory(const char* data, size_t size, const STLLoadOptions& options) {
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+
+    //Lattice welding happens after parsing, on the snapped keys
+    STLLoadOptions parseOptions = options;
+    if (options.snapSpacing > 0.0f)
+        parseOptions.weldVertices = false;
+
+    if (options.progress)
+        options.progress->totalBytes = size;
+
+    if (GzipStream::isGzip(data, size)) {
+        //Decompressed data is parsed window by window, so it's never held in full
+        if (parseOptions.sampleFacets != 0) {
+            FacetAppender appender(*mesh, parseOptions);
+            StrideSampler<FacetAppender> sampler{ appender, parseOptions.sampleFacets };
+            visitCompressedFacets(data, size, sampler, parseOptions.progress, parseNormals(parseOptions));
+        }
+        else {
+            FacetAppender appender(*mesh, parseOptions, true);
+            visitCompressedFacets(data, size, appender, parseOptions.progress, parseNormals(parseOptions));
+            appender.finish();
         }
     }
+    else if (isBinary(data, size)) {
+        loadBinary(data, size, *mesh, parseOptions);
+    }
+    else {
+        loadAscii(data, size, *mesh, parseOptions);
+    }
+
+    if (isCancelled(options))
+        return nullptr;
+
+    if (options.snapSpacing > 0.0f) {
+        MeshOperations::snapToLattice(*mesh, options.snapSpacing);
+        if (options.weldVertices)
+            MeshOperations::weldLatticeVertices(*mesh);
+    }
+
+    //Parts are only kept for files that really hold several solids
+    if (mesh->subMeshCount() == 1)
+        mesh->getSubMeshes().clear();
 
     std::cout << "Loaded: " << mesh->vertexCount() << " vertices, "
         << mesh->triangleCount() << " triangles" << std::endl;
 
     return mesh;
 }
+
+STLLoadHandle STLLoader::loadAsync(const std::string& filename, const STLLoadOptions& options, std::function<void(Mesh&)> onLoaded) {
+    STLLoadHandle handle;
+    handle.progress = std::make_shared<STLLoadProgress>();
+
+    STLLoadOptions asyncOptions = options;
+    asyncOptions.progress = handle.progress.get();
+
+    //The task owns a reference to the progress block, so it outlives a discarded handle
+    std::shared_ptr<STLLoadProgress> progress = handle.progress;
+    handle.result = std::async(std::launch::async, [filename, asyncOptions, progress, onLoaded]() {
+        std::shared_ptr<Mesh> mesh = load(filename, asyncOptions);
+        if (mesh && onLoaded && !progress->cancelRequested)
+            onLoaded(*mesh);
+        return progress->cancelRequested ? nullptr : mesh;
+    }).share();
+
+    return handle;
+}
+
+bool STLLoadHandle::isReady() const {
+    return result.valid() && result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void STLLoadHandle::cancel() {
+    if (progress)
+        progress->cancelRequested = true;
+}
+
+float STLLoadHandle::fraction() const {
+    if (!progress || progress->totalBytes == 0)
+        return 0.0f;
+    return static_cast<float>(progress->bytesProcessed) / static_cast<float>(progress->totalBytes);
+}
+
+bool STLLoader::reportProgress(STLLoadProgress* progress, size_t bytes, size_t facets) {
+    progress->bytesProcessed.fetch_add(bytes, std::memory_order_relaxed);
+    progress->facetsProcessed.fetch_add(facets, std::memory_order_relaxed);
+    return !progress->cancelRequested.load(std::memory_order_relaxed);
+}
+
+bool STLLoader::parseNormals(const STLLoadOptions& options) {
+    return options.normals == STLNormalMode::FromFile;
+}
+
+bool STLLoader::isCancelled(const STLLoadOptions& options) {
+    return options.progress && options.progress->cancelRequested;
+}
+
+bool STLLoader::isBinary(const char* data, size_t size) {
+    if (size < BINARY_HEADER_SIZE)
+        return false;
+
+    uint64_t triangleCount = declaredBinaryFacetCount(data);
+    return looksBinary(data, std::min(size, FORMAT_SNIFF_SIZE), BINARY_HEADER_SIZE + triangleCount * BINARY_RECORD_SIZE == size);
+}
+
+bool STLLoader::looksBinary(const char* head, size_t headSize, bool sizeMatches) {
+    //The size check is authoritative: many exporters write "solid" into binary headers too
+    if (sizeMatches)
+        return true;
+
+    //Size doesn't match (truncated binary file, or ASCII). Text starts with "solid" (after an
+    //optional UTF-8 byte order mark), holds no control bytes and has a facet or its endsolid early on.
+    //A binary header that merely starts with "solid" fails on the records after it
+    const char* end = head + headSize;
+    TextScanner text{ head, end };
+    text.skipByteOrderMark();
+    head = text.p;
+    if (!startsWithSolid(head))
+        return true;
+
+    bool printable = std::all_of(head, end, [](char c) {
+        return static_cast<unsigned char>(c) >= 0x20 || isTextSpace(c);
+    });
+    auto contains = [&](std::string_view keyword) {
+        return std::search(head, end, keyword.begin(), keyword.end()) != end;
+    };
+    return !printable || !(contains("facet") || contains("endsolid"));
+}
+
+bool STLLoader::startsWithSolid(const char* header) {
+    //"solid" after optional whitespace, within the 80 byte binary header area
+    const char* p = header;
+    const char* end = header + 80;
+    while (p < end && isTextSpace(*p))
+        ++p;
+    return end - p >= 5 && std::strncmp(p, "solid", 5) == 0;
+}
+
+void STLLoader::loadAscii(const char* data, size_t size, Mesh& mesh, const STLLoadOptions& options) {
+    const char* end = data + size;
+
+    if (options.sampleFacets != 0) {
+        loadSampledAscii(data, size, mesh, options);
+        return;
+    }
+
+    //Small files aren't worth the thread startup
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, std::max<size_t>(1, size / MIN_ASCII_CHUNK_SIZE));
+
+    if (threadCount == 1) {
+        FacetAppender appender(mesh, options, true);
+        appender.reserve(estimateAsciiFacetCount(data, end));
+        visitAsciiFacets(data, end, appender, options.progress, parseNormals(options));
+        appender.finish();
+        return;
+    }
+
+    //Split at facet boundaries: each chunk ends right after an "endfacet" token
+    std::vector<const char*> bounds{ data };
+    const std::string_view endFacet = "endfacet";
+    for (size_t i = 1; i < threadCount; ++i) {
+        const char* from = std::max(data + size * i / threadCount, bounds.back());
+        const char* hit = std::search(from, end, endFacet.begin(), endFacet.end());
+        if (hit == end)
+            break;
+        bounds.push_back(hit + endFacet.size());
+    }
+    bounds.push_back(end);
+
+    //Parse every chunk concurrently into chunk-local arrays, welding within each solid of the chunk
+    size_t chunkCount = bounds.size() - 1;
+    std::vector<ParsedChunk> chunks(chunkCount);
+    {
+        std::vector<std::thread> workers;
+        for (size_t c = 0; c < chunkCount; ++c) {
+            workers.emplace_back([&, c]() {
+                ParsedChunk& chunk = chunks[c];
+                FacetAppender appender(chunk.mesh, options, true);
+                appender.reserve(estimateAsciiFacetCount(bounds[c], bounds[c + 1]));
+                visitAsciiFacets(bounds[c], bounds[c + 1], appender, options.progress, parseNormals(options));
+                appender.finish();
+                chunk.continuesSolid = appender.startsWithContinuedSolid();
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    if (isCancelled(options))
+        return;
+
+    stitchChunks(chunks, mesh, options);
+}
+
+void STLLoader::loadSampledAscii(const char* data, size_t size, Mesh& mesh, const STLLoadOptions& options) {
+    const char* end = data + size;
+    FacetAppender appender(mesh, options);
+
+    size_t estimated = estimateAsciiFacetCount(data, end);
+    if (estimated <= options.sampleFacets) {
+        appender.reserve(estimated);
+        visitAsciiFacets(data, end, appender, options.progress, parseNormals(options));
+        return;
+    }
+
+    //Runs of neighbouring facets keep some connectivity, so the preview shows surface patches
+    //rather than scattered triangles. Each window resyncs just after its first "endfacet" (the
+    //first window starts at the file's beginning) and then takes its share of whole facets,
+    //never reading past the start of the next window so no facet is taken twice.
+    //Resyncing loses about one facet per window, so there are only as many windows as the
+    //facets left over after sampling can pay for (with margin for the estimate being off)
+    size_t windows = std::min(SAMPLE_ASCII_CHUNKS, options.sampleFacets);
+    windows = std::max<size_t>(1, std::min(windows, (estimated - options.sampleFacets) / 2));
+    appender.reserve(options.sampleFacets);
+
+    const std::string_view endFacet = "endfacet";
+    for (size_t c = 0; c < windows; ++c) {
+        const char* from = data + size * c / windows;
+        const char* limit = data + size * (c + 1) / windows;
+        size_t share = options.sampleFacets * (c + 1) / windows - options.sampleFacets * c / windows;
+        size_t before = mesh.triangleCount();
+
+        const char* first = from;
+        if (c > 0) {
+            first = std::search(from, limit, endFacet.begin(), endFacet.end());
+            first = first == limit ? limit : first + endFacet.size();
+        }
+        const char* last = first;
+        for (size_t k = 0; k < share; ++k) {
+            const char* found = std::search(last, limit, endFacet.begin(), endFacet.end());
+            if (found == limit)
+                break;
+            last = found + endFacet.size();
+        }
+        if (last != first)
+            visitAsciiFacets(first, last, appender, nullptr, parseNormals(options));
+
+        //Progress covers the skipped bytes up to the next window as well
+        size_t covered = static_cast<size_t>(limit - from);
+        if (options.progress && !reportProgress(options.progress, covered, mesh.triangleCount() - before))
+            return;
+    }
+}
+
+void STLLoader::stitchChunks(std::vector<ParsedChunk>& chunks, Mesh& mesh, const STLLoadOptions& options) {
+    std::vector<glm::vec3>& positions = mesh.getPositions();
+    std::vector<uint32_t>& indices = mesh.getIndices();
+    std::vector<glm::vec3>& faceNormals = mesh.getFaceNormals();
+    std::vector<SubMesh>& parts = mesh.getSubMeshes();
+    size_t chunkCount = chunks.size();
+    bool weld = options.weldVertices;
+
+    //Map every chunk-local vertex to its place in the mesh and rebuild the parts in file order.
+    //Without welding that's a plain offset; with welding the chunk-unique vertices of each part
+    //go through one table per part
+    VertexWelder welder(positions);
+    std::vector<std::vector<uint32_t>> remaps(chunkCount);
+    std::vector<size_t> vertexOffsets(chunkCount, 0);
+    std::vector<size_t> triangleOffsets(chunkCount, 0);
+    size_t vertexCursor = positions.size();
+    size_t triangleCursor = mesh.triangleCount();
+
+    auto closePart = [&]() {
+        if (parts.empty())
+            return;
+        parts.back().vertexCount = vertexCursor - parts.back().firstVertex;
+        parts.back().triangleCount = triangleCursor - parts.back().firstTriangle;
+    };
+
+    for (size_t c = 0; c < chunkCount; ++c) {
+        ParsedChunk& chunk = chunks[c];
+        std::vector<glm::vec3>& chunkPositions = chunk.mesh.getPositions();
+        const std::vector<SubMesh>& solids = chunk.mesh.getSubMeshes();
+        vertexOffsets[c] = vertexCursor;
+        triangleOffsets[c] = triangleCursor;
+        if (weld)
+            remaps[c].reserve(chunkPositions.size());
+
+        for (size_t k = 0; k < solids.size(); ++k) {
+            const SubMesh& solid = solids[k];
+            bool continuesPart = k == 0 && chunk.continuesSolid && !parts.empty();
+            if (!continuesPart) {
+                closePart();
+                parts.push_back(SubMesh{ solid.name, vertexCursor, 0, triangleCursor, 0 });
+                welder.clear();
+            }
+
+            if (weld) {
+                for (size_t i = 0; i < solid.vertexCount; ++i)
+                    remaps[c].push_back(welder.add(chunkPositions[solid.firstVertex + i]));
+                vertexCursor = positions.size();
+            }
+            else {
+                vertexCursor += solid.vertexCount;
+            }
+            triangleCursor += solid.triangleCount;
+        }
+
+        if (weld)
+            std::vector<glm::vec3>().swap(chunkPositions);
+    }
+    closePart();
+
+    //Triangles keep their file order, so every chunk can be written out concurrently
+    bool withFaceNormals = options.normals != STLNormalMode::Skip;
+    if (!weld)
+        positions.resize(vertexCursor);
+    indices.resize(triangleCursor * 3);
+    if (withFaceNormals)
+        faceNormals.resize(triangleCursor);
+
+    std::vector<std::thread> workers;
+    for (size_t c = 0; c < chunkCount; ++c) {
+        workers.emplace_back([&, c]() {
+            Mesh& chunkMesh = chunks[c].mesh;
+            uint32_t* out = indices.data() + triangleOffsets[c] * 3;
+
+            if (weld) {
+                const std::vector<uint32_t>& remap = remaps[c];
+                for (uint32_t index : chunkMesh.getIndices())
+                    *out++ = remap[index];
+            }
+            else {
+                const std::vector<glm::vec3>& chunkPositions = chunkMesh.getPositions();
+                std::copy(chunkPositions.begin(), chunkPositions.end(), positions.begin() + vertexOffsets[c]);
+
+                uint32_t offset = static_cast<uint32_t>(vertexOffsets[c]);
+                for (uint32_t index : chunkMesh.getIndices())
+                    *out++ = index + offset;
+            }
+
+            if (withFaceNormals) {
+                const std::vector<glm::vec3>& chunkNormals = chunkMesh.getFaceNormals();
+                std::copy(chunkNormals.begin(), chunkNormals.end(), faceNormals.begin() + triangleOffsets[c]);
+            }
+
+            //Release chunk memory as soon as it has been copied
+            chunks[c] = ParsedChunk();
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+}
+
+template <typename Visitor>
+bool STLLoader::visitAsciiFacets(const char* begin, const char* end, Visitor&& visitor, STLLoadProgress* progress, bool readNormals) {
+    TextScanner scanner{ begin, end };
+    scanner.skipByteOrderMark();
+    STLFacet facet;
+    int cornerCount = 0;
+
+    const char* reported = begin;
+    size_t unreportedFacets = 0;
+
+    while (true) {
+        std::string_view word = scanner.nextWord();
+        if (word.empty())
+            break;
+
+        if (word == "vertex") {
+            glm::vec3 position = scanner.nextVec3();
+            if (cornerCount < 3)
+                facet.vertices[cornerCount] = position;
+            ++cornerCount;
+        }
+        else if (word == "facet") {
+            if (readNormals) {
+                scanner.nextWord(); //"normal"
+                facet.normal = scanner.nextVec3();
+            }
+            else {
+                //"normal" and its three numbers, skipped as tokens without parsing
+                for (int i = 0; i < 4; ++i)
+                    scanner.nextWord();
+            }
+            cornerCount = 0;
+        }
+        else if (word == "endfacet") {
+            // After reading 3 vertices, emit the facet
+            if (cornerCount == 3) {
+                visitor(facet);
+
+                if (progress && ++unreportedFacets == PROGRESS_INTERVAL) {
+                    if (!reportProgress(progress, static_cast<size_t>(scanner.p - reported), unreportedFacets))
+                        return false;
+                    reported = scanner.p;
+                    unreportedFacets = 0;
+                }
+            }
+            cornerCount = 0;
+        }
+        else if (word == "solid") {
+            //Solid names are free text up to the end of the line (or the first facet on it)
+            std::string_view name = scanner.textBefore({ "facet", "endsolid" });
+            if constexpr (requires { visitor.beginSolid(name); })
+                visitor.beginSolid(name);
+        }
+        else if (word == "endsolid") {
+            scanner.textBefore({ "solid", "facet" });
+        }
+    }
+
+    if (progress)
+        return reportProgress(progress, static_cast<size_t>(end - reported), unreportedFacets);
+    return true;
+}
+
+uint32_t STLLoader::declaredBinaryFacetCount(const char* data) {
+    uint32_t triangleCount;
+    std::memcpy(&triangleCount, data + 80, sizeof(triangleCount));
+    return triangleCount;
+}
+
+size_t STLLoader::binaryFacetCount(const char* data, size_t size) {
+    //Truncated files: only the records that are actually present count
+    size_t available = (size - BINARY_HEADER_SIZE) / BINARY_RECORD_SIZE;
+    return std::min<size_t>(declaredBinaryFacetCount(data), available);
+}
+
+bool STLLoader::isCompressedBinary(const char* window, size_t filled, uint32_t uncompressedSize) {
+    if (filled < BINARY_HEADER_SIZE)
+        return false;
+
+    //The trailer only keeps the size modulo 2^32 (and is garbage for truncated files),
+    //which the facet check in looksBinary covers
+    uint32_t expected = static_cast<uint32_t>(BINARY_HEADER_SIZE + uint64_t(declaredBinaryFacetCount(window)) * BINARY_RECORD_SIZE);
+    return looksBinary(window, std::min(filled, FORMAT_SNIFF_SIZE), expected == uncompressedSize);
+}
+
+void STLLoader::loadBinary(const char* data, size_t size, Mesh& mesh, const STLLoadOptions& options) {
+    FacetAppender appender(mesh, options);
+    if (options.sampleFacets != 0) {
+        //Only the pages holding sampled records are touched
+        size_t count = binaryFacetCount(data, size);
+        size_t stride = std::max<size_t>(1, (count + options.sampleFacets - 1) / options.sampleFacets);
+        appender.reserve(count / stride + 1);
+
+        STLFacet facet;
+        for (size_t i = 0; i < count; i += stride) {
+            std::memcpy(&facet, data + BINARY_HEADER_SIZE + i * BINARY_RECORD_SIZE, sizeof(facet));
+            appender(facet);
+        }
+        if (options.progress)
+            reportProgress(options.progress, size, mesh.triangleCount());
+        return;
+    }
+
+    appender.reserve(binaryFacetCount(data, size));
+    visitBinaryFacets(data, size, appender, options.progress);
+}
+
+template <typename Visitor>
+bool STLLoader::visitBinaryFacets(const char* data, size_t size, Visitor&& visitor, STLLoadProgress* progress) {
+    size_t count = binaryFacetCount(data, size);
+    if (count < declaredBinaryFacetCount(data)) {
+        std::cout << "Binary STL is truncated: header declares " << declaredBinaryFacetCount(data)
+            << " triangles, file holds " << count << std::endl;
+    }
+
+    //normal[3], v1[3], v2[3], v3[3] as little-endian floats, then uint16 attribute
+    static_assert(sizeof(STLFacet) == 12 * sizeof(float), "STLFacet must match the binary record layout");
+
+    if (progress && !reportProgress(progress, BINARY_HEADER_SIZE, 0))
+        return false;
+
+    STLFacet facet;
+    const char* record = data + BINARY_HEADER_SIZE;
+    for (size_t i = 0; i < count; ++i, record += BINARY_RECORD_SIZE) {
+        std::memcpy(&facet, record, sizeof(facet));
+        visitor(facet);
+
+        if (progress && (i + 1) % PROGRESS_INTERVAL == 0) {
+            if (!reportProgress(progress, PROGRESS_INTERVAL * BINARY_RECORD_SIZE, PROGRESS_INTERVAL))
+                return false;
+        }
+    }
+
+    if (progress) {
+        size_t unreported = count % PROGRESS_INTERVAL;
+        return reportProgress(progress, size - BINARY_HEADER_SIZE - (count - unreported) * BINARY_RECORD_SIZE, unreported);
+    }
+    return true;
+}
+
+template <typename Visitor>
+bool STLLoader::visitCompressedFacets(const char* data, size_t size, Visitor&& visitor, STLLoadProgress* progress, bool readNormals) {
+    GzipStream stream(data, size);
+    if (stream.hasError())
+        return true;
+    uint32_t uncompressedSize = GzipStream::uncompressedSizeHint(data, size);
+
+    //Decompressed bytes live in a fixed window; unparsed tails are moved to the front before each refill
+    std::vector<char> window(COMPRESSED_WINDOW_SIZE);
+    size_t filled = 0;
+    bool endOfStream = false;
+
+    auto refill = [&]() {
+        while (!endOfStream && filled < window.size()) {
+            size_t produced = stream.read(window.data() + filled, window.size() - filled);
+            if (produced == 0)
+                endOfStream = true;
+            filled += produced;
+        }
+    };
+
+    //Forwards to the caller's visitor, counting facets for progress reports
+    size_t facetCount = 0;
+    struct CountingVisitor {
+        Visitor& visitor;
+        size_t& count;
+
+        void operator()(const STLFacet& facet) {
+            visitor(facet);
+            ++count;
+        }
+
+        void beginSolid(std::string_view name) {
+            if constexpr (requires { visitor.beginSolid(name); })
+                visitor.beginSolid(name);
+        }
+    } countingVisitor{ visitor, facetCount };
+
+    //Progress is measured in compressed bytes, matching totalBytes
+    size_t reportedBytes = 0;
+    size_t reportedFacets = 0;
+    auto publish = [&]() {
+        if (!progress)
+            return true;
+        size_t consumed = stream.compressedBytesConsumed();
+        bool keepGoing = reportProgress(progress, consumed - reportedBytes, facetCount - reportedFacets);
+        reportedBytes = consumed;
+        reportedFacets = facetCount;
+        return keepGoing;
+    };
+
+    refill();
+
+    if (isCompressedBinary(window.data(), filled, uncompressedSize)) {
+        size_t remaining = declaredBinaryFacetCount(window.data());
+        //Unlike plain files the header count can't be checked against the size up front, so only
+        //as much as the trailer's size allows is reserved and the visitor grows past that if needed
+        if constexpr (requires { visitor.reserve(remaining); })
+            visitor.reserve(std::min<size_t>(remaining, uncompressedSize / BINARY_RECORD_SIZE));
+
+        size_t offset = BINARY_HEADER_SIZE;
+        STLFacet facet;
+        while (remaining > 0) {
+            size_t records = std::min(remaining, (filled - offset) / BINARY_RECORD_SIZE);
+            const char* record = window.data() + offset;
+            for (size_t i = 0; i < records; ++i, record += BINARY_RECORD_SIZE) {
+                std::memcpy(&facet, record, sizeof(facet));
+                countingVisitor(facet);
+            }
+            offset += records * BINARY_RECORD_SIZE;
+            remaining -= records;
+
+            if (!publish())
+                return false;
+            if (endOfStream)
+                break;
+
+            std::memmove(window.data(), window.data() + offset, filled - offset);
+            filled -= offset;
+            offset = 0;
+            refill();
+        }
+
+        if (remaining > 0)
+            std::cout << "Binary STL is truncated: " << remaining << " declared triangles are missing" << std::endl;
+    }
+    else {
+        if constexpr (requires { visitor.reserve(size_t{}); })
+            visitor.reserve(estimateAsciiFacetCount(window.data(), window.data() + filled) * uncompressedSize / std::max<size_t>(filled, 1));
+
+        const std::string_view endFacet = "endfacet";
+        while (true) {
+            //Parse up to the last complete facet in the window, or everything once the stream has ended
+            const char* begin = window.data();
+            const char* end = begin + filled;
+            const char* cut = end;
+            if (!endOfStream) {
+                auto last = std::find_end(begin, end, endFacet.begin(), endFacet.end());
+                if (last == end) {
+                    //A single token longer than the window, grow it
+                    window.resize(window.size() * 2);
+                    refill();
+                    continue;
+                }
+                cut = last + endFacet.size();
+            }
+
+            visitAsciiFacets(begin, cut, countingVisitor, nullptr, readNormals);
+            if (!publish())
+                return false;
+            if (endOfStream)
+                break;
+
+            size_t consumed = static_cast<size_t>(cut - begin);
+            std::memmove(window.data(), window.data() + consumed, filled - consumed);
+            filled -= consumed;
+            refill();
+        }
+    }
+
+    if (stream.hasError())
+        std::cout << "Stopped reading at a decompression error" << std::endl;
+    return true;
+}
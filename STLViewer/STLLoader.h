@@ -1,11 +1,202 @@
 #pragma once
 #include <string>
-//#include <memory>
+#include <memory>
 #include <fstream>
 #include <iostream>
+#include <functional>
+#include <cstdint>
+#include <atomic>
+#include <future>
+#include <vector>
 #include "Mesh.h"
 
+//One facet as stored in the file, before any vertex sharing
+struct STLFacet {
+    glm::vec3 normal{ 0.0f, 0.0f, 0.0f };
+    glm::vec3 vertices[3];
+};
+
+//Progress counters shared between a running load and its observers
+struct STLLoadProgress {
+    std::atomic<uint64_t> bytesProcessed{ 0 };
+    std::atomic<uint64_t> totalBytes{ 0 };
+    std::atomic<uint64_t> facetsProcessed{ 0 };
+    std::atomic<bool> cancelRequested{ false };
+};
+
+//What the loader does with the facet normals stored in the file
+enum class STLNormalMode {
+    FromFile,   //Parse and keep them
+    Skip,       //Don't parse them, the mesh gets no face normals
+    Recompute   //Don't parse them, compute them from the vertex winding instead
+};
+
+//Options for STLLoader::load
+struct STLLoadOptions {
+    //Share vertices with identical positions while parsing, producing an indexed mesh
+    //in one pass (no separate MeshOperations::removeDuplicateVertices needed)
+    bool weldVertices = false;
+
+    //Files with garbage or zero normals, or callers that recompute them anyway, can skip them.
+    //MeshOperations::computePerVertexNormals computes missing face normals itself
+    STLNormalMode normals = STLNormalMode::FromFile;
+
+    //Preview mode: when non-zero, only about this many facets spread over the whole file are read,
+    //every k-th record of a binary file or short runs of facets from evenly spaced ASCII chunks.
+    //Parts aren't kept. Compressed files are still decompressed in full
+    size_t sampleFacets = 0;
+
+    //Lattice snapping: when non-zero, positions are snapped to an integer lattice with this spacing
+    //relative to the largest bounding box extent (e.g. 1e-6) and 64-bit keys are stored in Mesh::getLattice.
+    //Welding then is an exact sort on the keys instead of hashing floats. The file is parsed unwelded first
+    float snapSpacing = 0.0f;
+
+    //Region of interest: when set, facets whose bounding box doesn't overlap [regionMin, regionMax]
+    //are dropped as they are parsed, so memory and later processing scale with the region
+    bool clipToRegion = false;
+    glm::vec3 regionMin{ 0.0f, 0.0f, 0.0f };
+    glm::vec3 regionMax{ 0.0f, 0.0f, 0.0f };
+
+    //Optional progress reporting and cancellation, updated from the parsing threads
+    STLLoadProgress* progress = nullptr;
+};
+
+enum class STLFormat { Ascii, Binary };
+
+//Metadata returned by STLLoader::probe
+struct STLFileInfo {
+    STLFormat format = STLFormat::Ascii;
+    bool compressed = false;
+    uint64_t fileSize = 0;
+
+    //Binary header text up to the first NUL, or the name after the first "solid"
+    std::string name;
+
+    //Estimated from sampled facet sizes for large ASCII files
+    uint64_t triangleCount = 0;
+    bool exactCount = false;
+
+    //Covers the sampled facets only, unless exactBounds is set
+    glm::vec3 boundsMin{ 0.0f, 0.0f, 0.0f };
+    glm::vec3 boundsMax{ 0.0f, 0.0f, 0.0f };
+    bool exactBounds = false;
+};
+
+//Handle to a load running on a background thread, see STLLoader::loadAsync
+class STLLoadHandle {
+public:
+    bool isValid() const { return result.valid(); }
+    bool isReady() const;
+
+    //Blocks until the load finishes. Returns nullptr if the load was cancelled
+    std::shared_ptr<Mesh> get() const { return result.get(); }
+
+    void cancel();
+    float fraction() const; //0..1 of the file consumed
+    uint64_t bytesProcessed() const { return progress ? progress->bytesProcessed.load() : 0; }
+    uint64_t facetsProcessed() const { return progress ? progress->facetsProcessed.load() : 0; }
+
+private:
+    friend class STLLoader;
+    std::shared_future<std::shared_ptr<Mesh>> result;
+    std::shared_ptr<STLLoadProgress> progress;
+};
+
 class STLLoader {
 public:
-    static std::shared_ptr<Mesh> load(const std::string& filename);
-};
\ No newline at end of file
+    //Loads an ASCII or binary STL file, optionally gzip-compressed (.stl.gz).
+    //The format is detected from the file contents
+    //Returns nullptr if the load was cancelled through options.progress
+    static std::shared_ptr<Mesh> load(const std::string& filename, const STLLoadOptions& options = {});
+
+    //Same as load, for a file that is already in memory
+    static std::shared_ptr<Mesh> loadFromMemory(const char* data, size_t size, const STLLoadOptions& options = {});
+
+    //Loads many files with their reads overlapped (see BatchFileReader), parsing each one as soon as it
+    //has been read. Results are in the order of filenames, nullptr for files that couldn't be read.
+    //options.progress is ignored
+    static std::vector<std::shared_ptr<Mesh>> loadBatch(const std::vector<std::string>& filenames, const STLLoadOptions& options = {});
+
+    //Loads on a background thread. onLoaded, if set, runs on that thread after parsing
+    //so expensive preprocessing doesn't block the caller either
+    static STLLoadHandle loadAsync(const std::string& filename, const STLLoadOptions& options = {},
+                                   std::function<void(Mesh&)> onLoaded = nullptr);
+
+    //Streams every facet of the file to the visitor without building a Mesh.
+    //Memory use is independent of the file size. Returns false if the file can't be opened
+    static bool forEachFacet(const std::string& filename, const std::function<void(const STLFacet&)>& visitor);
+
+    //Decodes the corner positions of an uncompressed binary STL straight into caller-provided memory,
+    //such as a mapped GL buffer, without building a Mesh. allocate(facetCount) returns the destination
+    //(or nullptr to give up); corner c of facet f is written (3 * f + c) * stride bytes into it.
+    //Returns the number of facets written, 0 for ASCII or compressed files
+    static size_t decodeBinaryPositions(const std::string& filename, const std::function<char*(size_t)>& allocate, size_t stride);
+
+    //Reads format, name, triangle count and an approximate bounding box without building a Mesh.
+    //Binary files cost a header read plus a few thousand sampled records, ASCII files a few
+    //small windows spread over the file. Returns false if the file can't be opened
+    static bool probe(const std::string& filename, STLFileInfo& info);
+
+private:
+    //Binary STL: 80 byte header, uint32 triangle count, then 50 byte records
+    static constexpr size_t BINARY_HEADER_SIZE = 84;
+    static constexpr size_t BINARY_RECORD_SIZE = 50;
+
+    //ASCII files are split into chunks of at least this many bytes, one per thread
+    static constexpr size_t MIN_ASCII_CHUNK_SIZE = 1 << 20;
+
+    //Decompressed data is parsed through a window of this size
+    static constexpr size_t COMPRESSED_WINDOW_SIZE = 4 << 20;
+
+    //Sampled ASCII loads read facets from at most this many evenly spaced chunks
+    static constexpr size_t SAMPLE_ASCII_CHUNKS = 256;
+
+    //probe samples up to this many records of a binary file
+    static constexpr size_t PROBE_BINARY_SAMPLES = 4096;
+    //and this many windows of an ASCII file (read in full below PROBE_WINDOWS * PROBE_WINDOW_SIZE bytes)
+    static constexpr size_t PROBE_WINDOWS = 32;
+    static constexpr size_t PROBE_WINDOW_SIZE = 16 << 10;
+
+    //Progress is published (and cancellation checked) once per this many facets
+    static constexpr size_t PROGRESS_INTERVAL = 1 << 14;
+
+    //Format detection looks for a "facet" keyword in at most this many leading bytes
+    static constexpr size_t FORMAT_SNIFF_SIZE = 64 << 10;
+
+    static bool isBinary(const char* data, size_t size);
+    static bool startsWithSolid(const char* header);
+    //Shared by the mapped and the compressed path: head holds the first headSize bytes of the
+    //(decompressed) file, sizeMatches whether its size equals the binary header's facet count
+    static bool looksBinary(const char* head, size_t headSize, bool sizeMatches);
+    static void loadAscii(const char* data, size_t size, Mesh& mesh, const STLLoadOptions& options);
+    static void loadSampledAscii(const char* data, size_t size, Mesh& mesh, const STLLoadOptions& options);
+    //Result of parsing one chunk of an ASCII file, indices and parts are chunk-local
+    struct ParsedChunk {
+        Mesh mesh;                   //Its parts are the solids found in the chunk
+        bool continuesSolid = false; //The first part started in an earlier chunk
+    };
+
+    static void stitchChunks(std::vector<ParsedChunk>& chunks, Mesh& mesh, const STLLoadOptions& options);
+    static uint32_t declaredBinaryFacetCount(const char* data);
+    static size_t binaryFacetCount(const char* data, size_t size);
+    static void loadBinary(const char* data, size_t size, Mesh& mesh, const STLLoadOptions& options);
+    //Decides the format of a decompressed stream from its first window
+    static bool isCompressedBinary(const char* window, size_t filled, uint32_t uncompressedSize);
+
+    static void probeBinary(const char* data, size_t size, STLFileInfo& info);
+    static void probeAscii(const char* data, size_t size, STLFileInfo& info);
+    static void probeCompressed(const char* data, size_t size, STLFileInfo& info);
+
+    static bool reportProgress(STLLoadProgress* progress, size_t bytes, size_t facets);
+    static bool isCancelled(const STLLoadOptions& options);
+    static bool parseNormals(const STLLoadOptions& options);
+
+    //Both return false if the load was cancelled part way through
+    template <typename Visitor>
+    static bool visitAsciiFacets(const char* begin, const char* end, Visitor&& visitor, STLLoadProgress* progress = nullptr, bool readNormals = true);
+    template <typename Visitor>
+    static bool visitBinaryFacets(const char* data, size_t size, Visitor&& visitor, STLLoadProgress* progress = nullptr);
+    //Streams a gzip-compressed ASCII or binary file through a fixed-size window
+    template <typename Visitor>
+    static bool visitCompressedFacets(const char* data, size_t size, Visitor&& visitor, STLLoadProgress* progress = nullptr, bool readNormals = true);
+};
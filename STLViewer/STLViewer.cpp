@@ -3,6 +3,7 @@
 #include "STLLoader.h"
 #include "MeshOperations.h"
 #include "MeshRenderer.h"
+#include "MeshCache.h"
 #include <gtc/matrix_transform.hpp>
 #include <gtc/type_ptr.hpp>
 
@@ -106,6 +107,19 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     if (distance > 20.0f) distance = 20.0f;
 }
 
+// Center and bounding radius used to normalize the mesh into view
+void computeBounds(const Mesh& mesh, glm::vec3& center, float& radius) {
+    const PositionView positions = mesh.positionView();
+    glm::vec3 min = positions[0];
+    glm::vec3 max = min;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        min = glm::min(min, positions[i]);
+        max = glm::max(max, positions[i]);
+    }
+    center = (min + max) * 0.5f;
+    radius = glm::length(max - min) * 0.5f;
+}
+
 int main() {
     // --- Initialize GLFW ---
     if (!glfwInit()) {
@@ -137,44 +151,113 @@ int main() {
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-    // --- Load Mesh ---
-    //std::shared_ptr<Mesh> mesh = STLLoader::load("../Resources/Sphericon.stl");
-    std::shared_ptr<Mesh> mesh = STLLoader::load("../Resources/Cube.stl");
-    if (!mesh || mesh->vertexCount() == 0) {
-        std::cerr << "Failed to load mesh or no vertices found!" << std::endl;
-        return -1;
-    }
+    // --- Load Mesh (in the background, frames keep presenting meanwhile) ---
+    STLLoadOptions loadOptions;
+    loadOptions.weldVertices = true; // Duplicate vertices are merged while parsing
+    loadOptions.normals = STLNormalMode::Recompute; // File normals are often unreliable, derive them from the geometry
+
+    //const std::string meshPath = "../Resources/Sphericon.stl";
+    const std::string meshPath = "../Resources/Cube.stl";
+
+    // Very large meshes can be kept with 16-bit positions and octahedral normals once preprocessed
+    const bool quantizeVertices = false;
+
+    // Preprocessing runs on the loader thread too, the result is cached for the next launch
+    auto preprocess = [meshPath, loadOptions, quantizeVertices](Mesh& loaded) {
+        MeshOperations::computePerVertexNormals(loaded);
+        MeshOperations::computeAdjacency(loaded);
+        MeshOperations::printNeighborHistogram(loaded);
+        MeshCache::save(loaded, meshPath, loadOptions);
+        if (quantizeVertices)
+            MeshOperations::quantizeVertices(loaded);
+    };
+
+    std::shared_ptr<Mesh> mesh;
+    glm::vec3 center(0.0f);
+    float radius = 1.0f;
+
+    auto showMesh = [&](std::shared_ptr<Mesh> loaded) {
+        if (!loaded || loaded->vertexCount() == 0) {
+            std::cerr << "Failed to load mesh or no vertices found!" << std::endl;
+            return false;
+        }
 
-    std::cout << "Loaded mesh with " << mesh->vertexCount() << " vertices and "
-              << mesh->triangleCount() << " triangles." << std::endl;
+        std::cout << "Loaded mesh with " << loaded->vertexCount() << " vertices and "
+                  << loaded->triangleCount() << " triangles." << std::endl;
+        MeshOperations::printMeshDebugInfo(*loaded);
+        MeshOperations::printScratchStats();
 
-    // --- Preprocess Mesh ---
-    MeshOperations::removeDuplicateVertices(*mesh);
-    std::cout << "After removing duplicates: " << mesh->vertexCount() << " vertices." << std::endl;
+        computeBounds(*loaded, center, radius);
+        mesh = loaded;
+        return true;
+    };
 
-    MeshOperations::computePerVertexNormals(*mesh);
-    MeshOperations::computeAdjacency(*mesh);
-    MeshOperations::printNeighborCounts(*mesh);
-    MeshOperations::printMeshDebugInfo(*mesh);
+    MeshRenderer renderer;
 
-    // --- Compute Bounding Box & Normalize ---
-    glm::vec3 min = mesh->getVertices()[0].position;
-    glm::vec3 max = min;
-    for (const auto& v : mesh->getVertices()) {
-        min = glm::min(min, v.position);
-        max = glm::max(max, v.position);
+    // View-only sessions draw binary files straight from a mapped vertex buffer, without building a Mesh
+    const bool viewOnly = false;
+    bool uploaded = viewOnly && renderer.uploadBinarySTL(meshPath);
+
+    // A valid cache replaces parsing and preprocessing entirely
+    STLLoadHandle loadHandle;
+    STLLoadHandle previewHandle;
+    if (uploaded) {
+        STLFileInfo info;
+        STLLoader::probe(meshPath, info);
+        center = (info.boundsMin + info.boundsMax) * 0.5f;
+        radius = glm::length(info.boundsMax - info.boundsMin) * 0.5f;
+    }
+    else if (std::shared_ptr<Mesh> cachedMesh = MeshCache::load(meshPath, loadOptions)) {
+        if (quantizeVertices)
+            MeshOperations::quantizeVertices(*cachedMesh);
+        if (!showMesh(cachedMesh))
+            return -1;
+    }
+    else {
+        // Large files get a coarse sampled preview first, the full load replaces it when done
+        const size_t previewFacets = 200000;
+        STLFileInfo info;
+        if (STLLoader::probe(meshPath, info) && info.triangleCount > previewFacets) {
+            STLLoadOptions previewOptions = loadOptions;
+            previewOptions.sampleFacets = previewFacets;
+            previewHandle = STLLoader::loadAsync(meshPath, previewOptions, [](Mesh& preview) {
+                MeshOperations::computePerVertexNormals(preview);
+                MeshOperations::computeAdjacency(preview);
+            });
+        }
+        loadHandle = STLLoader::loadAsync(meshPath, loadOptions, preprocess);
     }
-    glm::vec3 center = (min + max) * 0.5f;
-    float radius = glm::length(max - min) * 0.5f;
 
     // --- Load Shaders ---
     GLuint shaderProgram = createShaderProgram("../Shaders/mesh.vert.glsl",
                                                "../Shaders/mesh.frag.glsl");
 
-    MeshRenderer renderer;
-
     // --- Main Render Loop ---
     while (!glfwWindowShouldClose(window)) {
+        // --- Swap in the preview, then the full mesh once loading finishes ---
+        if (previewHandle.isReady()) {
+            std::shared_ptr<Mesh> preview = previewHandle.get();
+            previewHandle = STLLoadHandle();
+            if (loadHandle.isValid())
+                showMesh(preview);
+        }
+
+        if (loadHandle.isValid()) {
+            if (loadHandle.isReady()) {
+                std::shared_ptr<Mesh> loaded = loadHandle.get();
+                loadHandle = STLLoadHandle();
+                if (!showMesh(loaded))
+                    break;
+                glfwSetWindowTitle(window, "Mesh Renderer");
+            }
+            else {
+                std::ostringstream title;
+                title << "Mesh Renderer - loading " << static_cast<int>(loadHandle.fraction() * 100.0f)
+                      << "% (" << loadHandle.facetsProcessed() << " facets)";
+                glfwSetWindowTitle(window, title.str().c_str());
+            }
+        }
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glUseProgram(shaderProgram);
 
@@ -199,13 +282,26 @@ int main() {
         glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
         // --- Render ---
-        renderer.renderMesh(*mesh);
-        renderer.renderNormals(*mesh);
+        if (mesh) {
+            renderer.renderMesh(*mesh);
+            renderer.renderNormals(*mesh);
+        }
+        else if (uploaded) {
+            renderer.renderUploaded();
+        }
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    // Don't wait for a half-finished load on exit
+    for (STLLoadHandle* pending : { &previewHandle, &loadHandle }) {
+        if (pending->isValid()) {
+            pending->cancel();
+            pending->get();
+        }
+    }
+
     // --- Cleanup ---
     glfwTerminate();
     std::cout << "Press Enter to exit..." << std::endl;
@@ -0,0 +1,155 @@
+#include "STLWriter.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+namespace {
+    //Same shape exporters use: 1.234567e+01
+    char* appendFloat(char* out, float value) {
+        return std::to_chars(out, out + 32, value, std::chars_format::scientific, 6).ptr;
+    }
+
+    char* appendText(char* out, std::string_view text) {
+        std::memcpy(out, text.data(), text.size());
+        return out + text.size();
+    }
+
+    char* appendVec3(char* out, const glm::vec3& v) {
+        out = appendFloat(out, v.x);
+        *out++ = ' ';
+        out = appendFloat(out, v.y);
+        *out++ = ' ';
+        return appendFloat(out, v.z);
+    }
+}
+
+glm::vec3 STLWriter::facetNormal(const Mesh& mesh, size_t t) {
+    if (mesh.hasFaceNormals() && mesh.getFaceNormals()[t] != glm::vec3(0.0f))
+        return mesh.getFaceNormals()[t];
+
+    const PositionView positions = mesh.positionView();
+    const uint32_t* tri = mesh.triangle(t);
+    glm::vec3 normal = glm::cross(positions[tri[1]] - positions[tri[0]],
+                                  positions[tri[2]] - positions[tri[0]]);
+    float length = glm::length(normal);
+    return length > 0.0f ? normal / length : glm::vec3(0.0f);
+}
+
+bool STLWriter::writeBinary(const Mesh& mesh, const std::string& filename) {
+    if (mesh.triangleCount() > std::numeric_limits<uint32_t>::max()) {
+        std::cout << "Too many triangles for binary STL: " << mesh.triangleCount() << std::endl;
+        return false;
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "Can't write file: " << filename << std::endl;
+        return false;
+    }
+
+    //80 byte header that doesn't start with "solid", so no reader mistakes it for ASCII
+    char header[84] = {};
+    std::strncpy(header, "Binary STL written by STLViewer", 80);
+    uint32_t triangleCount = static_cast<uint32_t>(mesh.triangleCount());
+    std::memcpy(header + 80, &triangleCount, sizeof(triangleCount));
+    file.write(header, sizeof(header));
+
+    //Records are assembled in a large buffer and written in few big calls
+    const size_t recordSize = 50;
+    const size_t recordsPerBuffer = WRITE_BUFFER_SIZE / recordSize;
+    std::vector<char> buffer(recordsPerBuffer * recordSize);
+
+    const PositionView positions = mesh.positionView();
+    for (size_t first = 0; first < mesh.triangleCount(); first += recordsPerBuffer) {
+        size_t count = std::min(recordsPerBuffer, mesh.triangleCount() - first);
+        char* out = buffer.data();
+        for (size_t i = first; i < first + count; ++i, out += recordSize) {
+            const uint32_t* tri = mesh.triangle(i);
+            glm::vec3 values[4] = { facetNormal(mesh, i), positions[tri[0]],
+                                    positions[tri[1]], positions[tri[2]] };
+            std::memcpy(out, values, sizeof(values));
+            out[48] = 0;
+            out[49] = 0;
+        }
+        file.write(buffer.data(), count * recordSize);
+    }
+
+    if (!file) {
+        std::cout << "Failed writing: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void STLWriter::formatAsciiFacets(const Mesh& mesh, size_t first, size_t count, std::string& out) {
+    //Upper bound per facet: keywords and indentation plus 12 numbers of at most 15 characters
+    const size_t maxFacetSize = 128 + 12 * 16;
+    out.resize(count * maxFacetSize);
+
+    const PositionView positions = mesh.positionView();
+    char* p = out.data();
+    for (size_t i = first; i < first + count; ++i) {
+        const uint32_t* tri = mesh.triangle(i);
+        p = appendText(p, "  facet normal ");
+        p = appendVec3(p, facetNormal(mesh, i));
+        p = appendText(p, "\n    outer loop\n      vertex ");
+        p = appendVec3(p, positions[tri[0]]);
+        p = appendText(p, "\n      vertex ");
+        p = appendVec3(p, positions[tri[1]]);
+        p = appendText(p, "\n      vertex ");
+        p = appendVec3(p, positions[tri[2]]);
+        p = appendText(p, "\n    endloop\n  endfacet\n");
+    }
+    out.resize(static_cast<size_t>(p - out.data()));
+}
+
+bool STLWriter::writeAscii(const Mesh& mesh, const std::string& filename, const std::string& solidName) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "Can't write file: " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<SubMesh> parts = mesh.getSubMeshes();
+    if (parts.empty())
+        parts.push_back(SubMesh{ solidName, 0, mesh.vertexCount(), 0, mesh.triangleCount() });
+
+    //Chunks are formatted concurrently, one batch per round, and written in order
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> texts(threadCount);
+
+    for (const SubMesh& part : parts) {
+        file << "solid " << part.name << "\n";
+
+        size_t next = part.firstTriangle;
+        size_t partEnd = part.firstTriangle + part.triangleCount;
+        while (next < partEnd) {
+            std::vector<std::thread> workers;
+            size_t used = 0;
+            for (; used < threadCount && next < partEnd; ++used) {
+                size_t count = std::min(ASCII_CHUNK_TRIANGLES, partEnd - next);
+                workers.emplace_back([&mesh, &texts, used, next, count]() {
+                    formatAsciiFacets(mesh, next, count, texts[used]);
+                });
+                next += count;
+            }
+            for (auto& worker : workers)
+                worker.join();
+
+            for (size_t c = 0; c < used; ++c)
+                file.write(texts[c].data(), texts[c].size());
+        }
+
+        file << "endsolid " << part.name << "\n";
+    }
+
+    if (!file) {
+        std::cout << "Failed writing: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+#include "Mesh.h"
+
+//Writes meshes back out as STL. Face normals are taken from the triangles
+//(recomputed from the geometry where they are zero)
+class STLWriter {
+public:
+    static bool writeBinary(const Mesh& mesh, const std::string& filename);
+
+    //Each part of a multi-part mesh becomes its own solid, otherwise everything goes into solidName
+    static bool writeAscii(const Mesh& mesh, const std::string& filename, const std::string& solidName = "mesh");
+
+private:
+    static constexpr size_t WRITE_BUFFER_SIZE = 4 << 20;
+    static constexpr size_t ASCII_CHUNK_TRIANGLES = 1 << 15;
+
+    static glm::vec3 facetNormal(const Mesh& mesh, size_t t);
+    static void formatAsciiFacets(const Mesh& mesh, size_t first, size_t count, std::string& out);
+};
@@ -0,0 +1,38 @@
+#include "ScratchMemory.h"
+#include <algorithm>
+
+std::atomic<size_t> ScratchArena::totalRequests{ 0 };
+std::atomic<size_t> ScratchArena::totalSystemAllocations{ 0 };
+std::atomic<size_t> ScratchArena::totalSystemBytes{ 0 };
+
+void* CountingResource::do_allocate(size_t size, size_t alignment) {
+    void* p = upstream->allocate(size, alignment);
+    ++allocations;
+    bytes += size;
+    return p;
+}
+
+void CountingResource::do_deallocate(void* p, size_t size, size_t alignment) {
+    upstream->deallocate(p, size, alignment);
+}
+
+ScratchArena::ScratchArena(size_t expectedBytes)
+    : system(std::pmr::new_delete_resource()),
+      arena(std::max(expectedBytes, MIN_BLOCK_SIZE), &system),
+      pools(&arena),
+      requests(&pools) {
+}
+
+ScratchArena::~ScratchArena() {
+    totalRequests += requests.allocationCount();
+    totalSystemAllocations += system.allocationCount();
+    totalSystemBytes += system.bytesAllocated();
+}
+
+ScratchStats ScratchArena::totals() {
+    ScratchStats stats;
+    stats.requests = totalRequests;
+    stats.systemAllocations = totalSystemAllocations;
+    stats.systemBytes = totalSystemBytes;
+    return stats;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <memory_resource>
+#include <atomic>
+#include <cstddef>
+
+//Passes allocations through to another resource and counts them.
+//Not thread-safe, like the pool resources it sits next to
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream) : upstream(upstream) {}
+
+    size_t allocationCount() const { return allocations; }
+    size_t bytesAllocated() const { return bytes; }
+
+private:
+    void* do_allocate(size_t size, size_t alignment) override;
+    void do_deallocate(void* p, size_t size, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource* upstream;
+    size_t allocations = 0;
+    size_t bytes = 0;
+};
+
+//Totals over every ScratchArena destroyed so far
+struct ScratchStats {
+    size_t requests = 0;          //Allocations the containers asked for
+    size_t systemAllocations = 0; //Allocations that reached the heap
+    size_t systemBytes = 0;
+};
+
+//Memory for the temporary containers of one pass, used from a single thread.
+//Small blocks come from pools that reuse freed blocks, the pools are refilled from a monotonic
+//arena that grows in a few large blocks, and all of it is released at once when the arena goes away.
+//Containers using resource() must be destroyed before the arena
+class ScratchArena {
+public:
+    //expectedBytes sizes the first block, later blocks grow geometrically from it
+    explicit ScratchArena(size_t expectedBytes);
+    ~ScratchArena();
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &requests; }
+
+    static ScratchStats totals();
+
+private:
+    static constexpr size_t MIN_BLOCK_SIZE = 64 << 10;
+
+    CountingResource system;
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::unsynchronized_pool_resource pools;
+    CountingResource requests;
+
+    static std::atomic<size_t> totalRequests;
+    static std::atomic<size_t> totalSystemAllocations;
+    static std::atomic<size_t> totalSystemBytes;
+};
@@ -0,0 +1,215 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string_view>
+#include <system_error>
+#include <glm.hpp>
+
+inline bool isTextSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
+//Walks an in-memory text buffer (usually a MappedFile) token by token without allocating
+struct TextScanner {
+    const char* p;
+    const char* end;
+
+    bool atEnd() const { return p >= end; }
+
+    //Steps over the UTF-8 byte order mark some editors put in front of text files
+    void skipByteOrderMark() {
+        const std::string_view bom = "\xEF\xBB\xBF";
+        if (static_cast<size_t>(end - p) >= bom.size() && std::string_view(p, bom.size()) == bom)
+            p += bom.size();
+    }
+
+    void skipSpace() {
+        while (p < end && isTextSpace(*p))
+            ++p;
+    }
+
+    //Skips spaces and tabs only, so the scanner stays on the current line
+    void skipInlineSpace() {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            ++p;
+    }
+
+    bool atLineEnd() {
+        skipInlineSpace();
+        return p >= end || *p == '\n' || *p == '\r';
+    }
+
+    std::string_view nextWord() {
+        skipSpace();
+        const char* start = p;
+        while (p < end && !isTextSpace(*p))
+            ++p;
+        return std::string_view(start, static_cast<size_t>(p - start));
+    }
+
+    //Moves to the '\n' that ends the current line
+    void skipLine() {
+        while (p < end && *p != '\n')
+            ++p;
+    }
+
+    //Remainder of the current line without surrounding whitespace
+    std::string_view restOfLine() {
+        while (p < end && *p != '\n' && isTextSpace(*p))
+            ++p;
+        const char* start = p;
+        skipLine();
+        const char* stop = p;
+        while (stop > start && isTextSpace(stop[-1]))
+            --stop;
+        return std::string_view(start, static_cast<size_t>(stop - start));
+    }
+
+    //Text up to the end of the line or the first of the keywords on it, without surrounding
+    //whitespace. The scanner stops in front of the keyword, so files written on one line still parse
+    std::string_view textBefore(std::initializer_list<std::string_view> keywords) {
+        skipInlineSpace();
+        const char* start = p;
+        const char* stop = p;
+        while (!atLineEnd()) {
+            const char* token = p;
+            while (p < end && !isTextSpace(*p))
+                ++p;
+            std::string_view word(token, static_cast<size_t>(p - token));
+            for (std::string_view keyword : keywords) {
+                if (word == keyword) {
+                    p = token;
+                    return std::string_view(start, static_cast<size_t>(stop - start));
+                }
+            }
+            stop = p;
+        }
+        return std::string_view(start, static_cast<size_t>(stop - start));
+    }
+
+    float nextFloat() {
+        skipSpace();
+        if (p < end && *p == '+') //from_chars doesn't accept a leading '+'
+            ++p;
+
+        float value = 0.0f;
+        if (parseShortFloat(value))
+            return value;
+
+        auto result = std::from_chars(p, end, value);
+        if (result.ec == std::errc::result_out_of_range) {
+            p = result.ptr;
+        }
+        else if (result.ec != std::errc()) {
+            //Not a number, skip the token and keep going
+            while (p < end && !isTextSpace(*p))
+                ++p;
+        }
+        else {
+            p = result.ptr;
+        }
+        return value;
+    }
+
+    //Fast path for the plain decimal forms exporters write ("-1.234567e+01", "0.5", "12"), after Clinger.
+    //With at most 19 significant digits and a power of ten up to 22 both the mantissa and
+    //the power are exact doubles, so one multiply or divide gives the correctly rounded double.
+    //Rounding that to float is exact unless the double sits right between two floats.
+    //Returns false, without moving, for anything else (the caller falls back to from_chars)
+    bool parseShortFloat(float& value) {
+        static constexpr double powersOfTen[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        const char* q = p;
+        bool negative = q < end && *q == '-';
+        if (negative)
+            ++q;
+
+        //Leading zeros are counted as digits too; numbers that long are rare enough to not matter
+        const char* digitsStart = q;
+        uint64_t mantissa = 0;
+        for (; q < end && static_cast<unsigned char>(*q - '0') < 10; ++q)
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*q - '0');
+        int exponent = 0;
+        size_t digits = static_cast<size_t>(q - digitsStart);
+        if (q < end && *q == '.') {
+            const char* fractionStart = ++q;
+            for (; q < end && static_cast<unsigned char>(*q - '0') < 10; ++q)
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*q - '0');
+            exponent = -static_cast<int>(q - fractionStart);
+            digits += static_cast<size_t>(q - fractionStart);
+        }
+        if (digits > 19)
+            return false;
+        bool anyDigit = digits > 0;
+        if (!anyDigit)
+            return false;
+
+        if (q < end && (*q == 'e' || *q == 'E')) {
+            ++q;
+            bool negativeExponent = q < end && *q == '-';
+            if (q < end && (*q == '-' || *q == '+'))
+                ++q;
+            if (q >= end || *q < '0' || *q > '9')
+                return false;
+            int written = 0;
+            for (; q < end && *q >= '0' && *q <= '9'; ++q) {
+                if (written < 1000)
+                    written = written * 10 + (*q - '0');
+            }
+            exponent += negativeExponent ? -written : written;
+        }
+
+        double result = static_cast<double>(mantissa);
+        if (mantissa != 0) {
+            //Mantissas above 2^53 would already have been rounded
+            if (mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+                return false;
+            result = exponent < 0 ? result / powersOfTen[-exponent] : result * powersOfTen[exponent];
+
+            //Leave overflow, subnormals and double rounding ties to the exact parser
+            if (result > 3.4028234663852886e38 || result < 1.1754943508222875e-38)
+                return false;
+            uint64_t bits;
+            std::memcpy(&bits, &result, sizeof(bits));
+            if ((bits & 0x1FFFFFFF) == 0x10000000)
+                return false;
+        }
+
+        value = static_cast<float>(negative ? -result : result);
+        p = q;
+        return true;
+    }
+
+    glm::vec3 nextVec3() {
+        float x = nextFloat();
+        float y = nextFloat();
+        float z = nextFloat();
+        return glm::vec3(x, y, z);
+    }
+
+    int64_t nextInt() {
+        skipSpace();
+        int64_t value = 0;
+        if (!parseInt(value)) {
+            while (p < end && !isTextSpace(*p))
+                ++p;
+        }
+        return value;
+    }
+
+    //Parses an integer at the current position (no whitespace skipping). Returns false if there is none
+    bool parseInt(int64_t& value) {
+        if (p < end && *p == '+')
+            ++p;
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+};
@@ -8,7 +8,13 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Quantized meshes upload 16-bit positions, decoded as origin + scale * value.
+// Float meshes keep the defaults
+uniform vec3 positionOrigin = vec3(0.0);
+uniform vec3 positionScale = vec3(1.0);
+
 void main() {
     fragColor = inColor;
-    gl_Position = projection * view * model * vec4(inPosition, 1.0);
+    vec3 position = positionOrigin + positionScale * inPosition;
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }